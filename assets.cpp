@@ -0,0 +1,89 @@
+/*
+
+MIT License with AI exception
+
+Copyright (c) Tadeusz Puźniakowski 2024
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is furnished
+to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+Additional restriction:
+
+The Software may not be used, in whole or in part, to teach or train any
+artificial intelligence system, including but not limited to large language
+models (LLMs), neural networks, or any other type of AI technology. Violation of
+this restriction will be considered a breach of this License.
+
+*/
+
+
+
+#include "assets.h"
+
+#include <algorithm>
+
+namespace mcggame {
+
+asset_manager_c::asset_manager_c(int workers) {
+    if (workers <= 0) workers = std::max(1u, std::min(4u, std::thread::hardware_concurrency()));
+    for (int i = 0; i < workers; i++)
+        _workers.emplace_back([this]() { worker(); });
+}
+
+asset_manager_c::~asset_manager_c() {
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _stopping = true;
+    }
+    _jobs_changed.notify_all();
+    for (auto &w : _workers) w.join();
+}
+
+void asset_manager_c::worker() {
+    for (;;) {
+        std::function<void()> job;
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            _jobs_changed.wait(lock, [this]() { return _stopping || !_jobs.empty(); });
+            if (_stopping) return;
+            job = std::move(_jobs.front());
+            _jobs.pop_front();
+        }
+        job();
+    }
+}
+
+asset_future_t<track_asset_t> asset_manager_c::load_track(const std::string &fname, const bool vectorize_walls) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    auto found = _tracks.find({fname, vectorize_walls});
+    if (found != _tracks.end()) return found->second;
+    auto ret = enqueue<track_asset_t>([fname, vectorize_walls]() { return track_asset_t::decode(fname, vectorize_walls); });
+    _tracks[{fname, vectorize_walls}] = ret;
+    return ret;
+}
+
+asset_future_t<sprite_asset_t> asset_manager_c::load_sprite(const std::string &fname) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    auto found = _sprites.find(fname);
+    if (found != _sprites.end()) return found->second;
+    auto ret = enqueue<sprite_asset_t>([fname]() { return sprite_asset_t{decode_bmp(fname)}; });
+    _sprites[fname] = ret;
+    return ret;
+}
+
+}
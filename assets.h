@@ -0,0 +1,132 @@
+/*
+
+MIT License with AI exception
+
+Copyright (c) Tadeusz Puźniakowski 2024
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is furnished
+to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+Additional restriction:
+
+The Software may not be used, in whole or in part, to teach or train any
+artificial intelligence system, including but not limited to large language
+models (LLMs), neural networks, or any other type of AI technology. Violation of
+this restriction will be considered a breach of this License.
+
+*/
+
+
+
+#ifndef MCGGAME_ASSETS_H
+#define MCGGAME_ASSETS_H
+
+#include "game.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace mcggame {
+
+template <class T>
+using asset_future_t = std::shared_future<std::shared_ptr<const T>>;
+
+template <class T>
+bool is_ready(const asset_future_t<T> &asset) {
+    return asset.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+}
+
+struct asset_progress_t {
+    int loaded;     ///< finished, also the ones that failed
+    int requested;
+
+    double fraction() const { return (requested > 0) ? (double)loaded/requested : 1.0; }
+    bool done() const { return loaded == requested; }
+};
+
+/**
+ * @brief Decodes assets on worker threads.
+ *
+ * Reading the files, building the collision maps and vectorizing the walls
+ * happen on the workers. The results come as futures of decoded assets; the
+ * textures are made from them later on the render thread, by race_track_t
+ * and car_t::set_sprite. Every file is decoded once, asking for it again
+ * gives the same future. Errors are thrown from the future's get().
+ */
+class asset_manager_c {
+    std::mutex _mutex;
+    std::condition_variable _jobs_changed;
+    std::deque<std::function<void()>> _jobs;
+    bool _stopping = false;
+    std::vector<std::thread> _workers;
+
+    std::map<std::pair<std::string, bool>, asset_future_t<track_asset_t>> _tracks;
+    std::map<std::string, asset_future_t<sprite_asset_t>> _sprites;
+
+    std::atomic<int> _requested = 0;
+    std::atomic<int> _loaded = 0;
+
+    void worker();
+
+    template <class T>
+    asset_future_t<T> enqueue(const std::function<T()> &decode) {
+        auto task = std::make_shared<std::packaged_task<std::shared_ptr<const T>()>>([this, decode]() {
+            struct count_loaded_t {
+                std::atomic<int> &loaded;
+                ~count_loaded_t() { loaded++; }
+            } count_loaded{_loaded};
+            return std::make_shared<const T>(decode());
+        });
+        asset_future_t<T> ret = task->get_future().share();
+        _requested++;
+        _jobs.push_back([task]() { (*task)(); });
+        _jobs_changed.notify_one();
+        return ret;
+    }
+
+public:
+    /**
+     * @param workers number of worker threads, 0 for one per core (at most 4)
+     */
+    asset_manager_c(int workers = 0);
+    asset_manager_c(const asset_manager_c &) = delete;
+    asset_manager_c &operator=(const asset_manager_c &) = delete;
+    virtual ~asset_manager_c();
+
+    /**
+     * @param vectorize_walls also prepare the walls for the SAT collision mode
+     */
+    asset_future_t<track_asset_t> load_track(const std::string &fname, const bool vectorize_walls = false);
+    asset_future_t<sprite_asset_t> load_sprite(const std::string &fname);
+
+    asset_progress_t progress() const { return {_loaded.load(), _requested.load()}; }
+};
+
+}
+
+#endif
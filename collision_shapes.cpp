@@ -0,0 +1,372 @@
+/*
+
+MIT License with AI exception
+
+Copyright (c) Tadeusz Puźniakowski 2024
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is furnished
+to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+Additional restriction:
+
+The Software may not be used, in whole or in part, to teach or train any
+artificial intelligence system, including but not limited to large language
+models (LLMs), neural networks, or any other type of AI technology. Violation of
+this restriction will be considered a breach of this License.
+
+*/
+
+#include "collision_shapes.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <unordered_map>
+
+namespace mcggame {
+
+collision_mode_e collision_mode_from_string(const std::string &name) {
+    if (name == "pixels") return collision_mode_e::PIXELS;
+    if (name == "sat") return collision_mode_e::SAT;
+    if (name == "fixed") return collision_mode_e::FIXED;
+    throw std::invalid_argument("unknown collision mode: " + name);
+}
+
+std::string to_string(collision_mode_e mode) {
+    switch (mode) {
+        case collision_mode_e::PIXELS: return "pixels";
+        case collision_mode_e::SAT: return "sat";
+        case collision_mode_e::FIXED: return "fixed";
+    }
+    return "unknown";
+}
+
+static double dot(const position_t &a, const position_t &b) {
+    return a[0]*b[0] + a[1]*b[1];
+}
+
+std::vector<segment_t> marching_squares(const logic_bitmap_t &collision_map, const int cell_x0, const int cell_y0, const int cell_x1, const int cell_y1) {
+    std::vector<segment_t> ret;
+    for (int cy = cell_y0; cy < cell_y1; cy++) {
+        for (int cx = cell_x0; cx < cell_x1; cx++) {
+            int tl = collision_map(cx, cy) == 255;
+            int tr = collision_map(cx + 1, cy) == 255;
+            int br = collision_map(cx + 1, cy + 1) == 255;
+            int bl = collision_map(cx, cy + 1) == 255;
+            int index = tl*8 + tr*4 + br*2 + bl;
+            if ((index == 0) || (index == 15)) continue;
+
+            position_t top = {cx + 1.0, cy + 0.5};
+            position_t right = {cx + 1.5, cy + 1.0};
+            position_t bottom = {cx + 1.0, cy + 1.5};
+            position_t left = {cx + 0.5, cy + 1.0};
+            switch (index) {
+                case 1: case 14: ret.push_back({left, bottom}); break;
+                case 2: case 13: ret.push_back({bottom, right}); break;
+                case 3: case 12: ret.push_back({left, right}); break;
+                case 4: case 11: ret.push_back({top, right}); break;
+                case 6: case 9: ret.push_back({top, bottom}); break;
+                case 7: case 8: ret.push_back({left, top}); break;
+                case 5: // saddles join the wall corners, so diagonal walls have no gaps
+                    ret.push_back({left, top});
+                    ret.push_back({bottom, right});
+                    break;
+                case 10:
+                    ret.push_back({top, right});
+                    ret.push_back({left, bottom});
+                    break;
+            }
+        }
+    }
+    return ret;
+}
+
+static int64_t point_key(const position_t &p) {
+    // contour points are on a half pixel grid
+    int64_t x = std::lround(p[0]*2.0);
+    int64_t y = std::lround(p[1]*2.0);
+    return (x << 32) ^ (y & 0x0ffffffff);
+}
+
+std::vector<std::vector<position_t>> chain_segments(const std::vector<segment_t> &segments) {
+    std::unordered_multimap<int64_t, int> endpoints;
+    for (int i = 0; i < (int)segments.size(); i++) {
+        endpoints.insert({point_key(segments[i].a), i});
+        endpoints.insert({point_key(segments[i].b), i});
+    }
+    std::vector<bool> used(segments.size(), false);
+    auto extend = [&](std::vector<position_t> &polyline) {
+        for (bool found = true; found;) {
+            found = false;
+            auto range = endpoints.equal_range(point_key(polyline.back()));
+            for (auto it = range.first; it != range.second; ++it) {
+                int j = it->second;
+                if (used[j]) continue;
+                used[j] = true;
+                const auto &s = segments[j];
+                polyline.push_back((point_key(s.a) == it->first) ? s.b : s.a);
+                found = true;
+                break;
+            }
+        }
+    };
+
+    std::vector<std::vector<position_t>> ret;
+    for (int i = 0; i < (int)segments.size(); i++) {
+        if (used[i]) continue;
+        used[i] = true;
+        std::vector<position_t> polyline = {segments[i].a, segments[i].b};
+        extend(polyline);
+        std::reverse(polyline.begin(), polyline.end());
+        extend(polyline);
+        ret.push_back(polyline);
+    }
+    return ret;
+}
+
+static double distance_to_segment(const position_t &p, const position_t &a, const position_t &b) {
+    auto ab = b - a;
+    auto l2 = dot(ab, ab);
+    if (l2 <= 0.0) return ~(p - a);
+    auto t = std::clamp(dot(p - a, ab) / l2, 0.0, 1.0);
+    return ~(p - (a + ab*t));
+}
+
+std::vector<position_t> simplify_polyline(const std::vector<position_t> &polyline, const double epsilon) {
+    if (polyline.size() < 3) return polyline;
+    std::vector<bool> keep(polyline.size(), false);
+    keep.front() = keep.back() = true;
+    std::vector<std::pair<int,int>> stack = {{0, (int)polyline.size() - 1}};
+    while (!stack.empty()) {
+        auto [first, last] = stack.back();
+        stack.pop_back();
+        double max_distance = 0.0;
+        int index = -1;
+        for (int i = first + 1; i < last; i++) {
+            double d = distance_to_segment(polyline[i], polyline[first], polyline[last]);
+            if (d > max_distance) {
+                max_distance = d;
+                index = i;
+            }
+        }
+        if ((index >= 0) && (max_distance > epsilon)) {
+            keep[index] = true;
+            stack.push_back({first, index});
+            stack.push_back({index, last});
+        }
+    }
+    std::vector<position_t> ret;
+    for (int i = 0; i < (int)polyline.size(); i++)
+        if (keep[i]) ret.push_back(polyline[i]);
+    return ret;
+}
+
+static aabb_t segments_aabb(const std::vector<segment_t> &segments, const int first, const int count) {
+    aabb_t box = {{INFINITY, INFINITY}, {-INFINITY, -INFINITY}};
+    for (int i = first; i < first + count; i++) {
+        for (const auto &p : {segments[i].a, segments[i].b}) {
+            box.min[0] = std::min(box.min[0], p[0]);
+            box.min[1] = std::min(box.min[1], p[1]);
+            box.max[0] = std::max(box.max[0], p[0]);
+            box.max[1] = std::max(box.max[1], p[1]);
+        }
+    }
+    return box;
+}
+
+static void build_bvh_node(wall_shapes_c::tile_t &tile, const int node, const int first, const int count) {
+    auto box = segments_aabb(tile.segments, first, count);
+    if (count <= 4) {
+        tile.nodes[node] = {box, first, count};
+        return;
+    }
+    int axis = ((box.max[0] - box.min[0]) > (box.max[1] - box.min[1])) ? 0 : 1;
+    int mid = first + count / 2;
+    std::nth_element(tile.segments.begin() + first, tile.segments.begin() + mid, tile.segments.begin() + first + count,
+        [axis](const segment_t &s1, const segment_t &s2) {
+            return (s1.a[axis] + s1.b[axis]) < (s2.a[axis] + s2.b[axis]);
+        });
+    int left = tile.nodes.size();
+    tile.nodes.push_back({});
+    tile.nodes.push_back({});
+    tile.nodes[node] = {box, left, 0};
+    build_bvh_node(tile, left, first, mid - first);
+    build_bvh_node(tile, left + 1, mid, first + count - mid);
+}
+
+wall_shapes_c::wall_shapes_c(const logic_bitmap_t &collision_map, const int tile_size, const double simplify_epsilon) :
+    _tile_size(tile_size), _simplify_epsilon(simplify_epsilon) {
+    if (tile_size <= 0) throw std::invalid_argument("tile size must be positive");
+    // cells start at -1, so there is one more cell than pixels in each direction
+    _tiles_w = (collision_map.w + _tile_size) / _tile_size;
+    _tiles_h = (collision_map.h + _tile_size) / _tile_size;
+    _tiles.resize(_tiles_w * _tiles_h);
+    for (int ty = 0; ty < _tiles_h; ty++)
+        for (int tx = 0; tx < _tiles_w; tx++)
+            rebuild_tile(collision_map, tx, ty);
+}
+
+void wall_shapes_c::rebuild_tile(const logic_bitmap_t &collision_map, const int tx, const int ty) {
+    auto &tile = _tiles[ty * _tiles_w + tx];
+    int cell_x0 = tx * _tile_size - 1;
+    int cell_y0 = ty * _tile_size - 1;
+    int cell_x1 = std::min(cell_x0 + _tile_size, collision_map.w);
+    int cell_y1 = std::min(cell_y0 + _tile_size, collision_map.h);
+
+    tile.segments.clear();
+    tile.nodes.clear();
+    auto raw_segments = marching_squares(collision_map, cell_x0, cell_y0, cell_x1, cell_y1);
+    for (const auto &polyline : chain_segments(raw_segments)) {
+        auto simplified = simplify_polyline(polyline, _simplify_epsilon);
+        for (int i = 0; i + 1 < (int)simplified.size(); i++)
+            tile.segments.push_back({simplified[i], simplified[i + 1]});
+    }
+    if (tile.segments.empty()) return;
+    tile.nodes.push_back({});
+    build_bvh_node(tile, 0, 0, tile.segments.size());
+}
+
+void wall_shapes_c::rebuild_region(const logic_bitmap_t &collision_map, const int x0, const int y0, const int x1, const int y1) {
+    // pixel x is a corner of the cells x-1 and x, which are in the tiles x/tile_size and (x+1)/tile_size
+    int tx0 = std::max(0, x0 / _tile_size);
+    int ty0 = std::max(0, y0 / _tile_size);
+    int tx1 = std::min(_tiles_w - 1, x1 / _tile_size);
+    int ty1 = std::min(_tiles_h - 1, y1 / _tile_size);
+    for (int ty = ty0; ty <= ty1; ty++)
+        for (int tx = tx0; tx <= tx1; tx++)
+            rebuild_tile(collision_map, tx, ty);
+}
+
+size_t wall_shapes_c::segment_count() const {
+    size_t count = 0;
+    for (const auto &tile : _tiles) count += tile.segments.size();
+    return count;
+}
+
+bool box_segment_overlap(const oriented_box_t &box, const position_t &box_axis_x, const position_t &box_axis_y, const segment_t &segment, position_t &contact) {
+    auto da = segment.a - box.center;
+    auto db = segment.b - box.center;
+    position_t a = {dot(da, box_axis_x), dot(da, box_axis_y)};
+    position_t b = {dot(db, box_axis_x), dot(db, box_axis_y)};
+    const auto &h = box.half_size;
+
+    // box axes
+    if ((std::min(a[0], b[0]) > h[0]) || (std::max(a[0], b[0]) < -h[0])) return false;
+    if ((std::min(a[1], b[1]) > h[1]) || (std::max(a[1], b[1]) < -h[1])) return false;
+    // segment normal
+    auto d = b - a;
+    position_t n = {-d[1], d[0]};
+    if (std::abs(dot(n, a)) > h[0]*std::abs(n[0]) + h[1]*std::abs(n[1])) return false;
+
+    // Liang-Barsky clip of the segment to the box gives the contact
+    double t0 = 0.0, t1 = 1.0;
+    for (int axis = 0; axis < 2; axis++) {
+        for (double side : {-1.0, 1.0}) {
+            double p = side * d[axis];
+            double q = h[axis] - side * a[axis];
+            if (p == 0.0) continue;
+            double t = q / p;
+            if (p < 0.0) t0 = std::max(t0, t);
+            else t1 = std::min(t1, t);
+        }
+    }
+    auto local = a + d * ((t0 + t1) * 0.5);
+    contact = box.center + box_axis_x * local[0] + box_axis_y * local[1];
+    return true;
+}
+
+double segment_penetration(const oriented_box_t &box, const position_t &box_axis_x, const position_t &box_axis_y, const segment_t &segment, const logic_bitmap_t &collision_map) {
+    auto da = segment.a - box.center;
+    auto db = segment.b - box.center;
+    position_t a = {dot(da, box_axis_x), dot(da, box_axis_y)};
+    position_t b = {dot(db, box_axis_x), dot(db, box_axis_y)};
+    const auto &h = box.half_size;
+
+    auto d = b - a;
+    double length = std::sqrt(dot(d, d));
+    if (length == 0.0) return 0.0;
+    position_t n = {-d[1] / length, d[0] / length};
+    // one pixel from the middle of the segment towards +n tells the wall side
+    auto middle = (segment.a + segment.b) * 0.5;
+    auto probe = middle + (box_axis_x * n[0] + box_axis_y * n[1]);
+    if (collision_map(probe[0], probe[1]) != 255) n = n * -1.0;
+
+    // the box gets out of the wall moving towards -n, along the segment both ways are open
+    double depth = h[0]*std::abs(n[0]) + h[1]*std::abs(n[1]) - dot(n, a);
+    for (int axis = 0; axis < 2; axis++) {
+        double towards_minus = h[axis] - std::min(a[axis], b[axis]);
+        double towards_plus = std::max(a[axis], b[axis]) + h[axis];
+        if (n[axis] > 1e-9) depth = std::min(depth, towards_minus);
+        else if (n[axis] < -1e-9) depth = std::min(depth, towards_plus);
+        else depth = std::min(depth, std::min(towards_minus, towards_plus));
+    }
+    return std::max(0.0, depth);
+}
+
+std::vector<position_t> wall_shapes_c::check_collision(const oriented_box_t &box, const logic_bitmap_t &collision_map, std::vector<double> *depths) const {
+    std::vector<position_t> ret;
+    double c = std::cos(box.angle);
+    double s = std::sin(box.angle);
+    position_t axis_x = {c, s};
+    position_t axis_y = {-s, c};
+    double ex = box.half_size[0]*std::abs(c) + box.half_size[1]*std::abs(s);
+    double ey = box.half_size[0]*std::abs(s) + box.half_size[1]*std::abs(c);
+    aabb_t query = {{box.center[0] - ex, box.center[1] - ey}, {box.center[0] + ex, box.center[1] + ey}};
+
+    // segments of the cell x lie in [x+0.5, x+1.5], and cell x is in tile (x+1)/tile_size
+    int tx0 = std::max(0, (int)std::floor((query.min[0] - 0.5) / _tile_size));
+    int ty0 = std::max(0, (int)std::floor((query.min[1] - 0.5) / _tile_size));
+    int tx1 = std::min(_tiles_w - 1, (int)std::floor((query.max[0] + 0.5) / _tile_size));
+    int ty1 = std::min(_tiles_h - 1, (int)std::floor((query.max[1] + 0.5) / _tile_size));
+
+    int stack[64];
+    for (int ty = ty0; ty <= ty1; ty++) {
+        for (int tx = tx0; tx <= tx1; tx++) {
+            const auto &t = tile(tx, ty);
+            if (t.nodes.empty()) continue;
+            int top = 0;
+            stack[top++] = 0;
+            while (top > 0) {
+                const auto &node = t.nodes[stack[--top]];
+                if ((node.box.min[0] > query.max[0]) || (node.box.max[0] < query.min[0]) ||
+                    (node.box.min[1] > query.max[1]) || (node.box.max[1] < query.min[1])) continue;
+                if (node.count == 0) {
+                    stack[top++] = node.first;
+                    stack[top++] = node.first + 1;
+                    continue;
+                }
+                for (int i = node.first; i < node.first + node.count; i++) {
+                    position_t contact;
+                    if (box_segment_overlap(box, axis_x, axis_y, t.segments[i], contact)) {
+                        ret.push_back(contact);
+                        if (depths) depths->push_back(segment_penetration(box, axis_x, axis_y, t.segments[i], collision_map));
+                    }
+                }
+            }
+        }
+    }
+    // no wall edge crosses the box, but it can still be buried in a wall
+    if (ret.empty() && (collision_map(box.center[0], box.center[1]) == 255)) {
+        ret.push_back(box.center);
+        // the whole box is in the wall, it has to move at least by its half diagonal
+        if (depths) depths->push_back(std::sqrt(dot(box.half_size, box.half_size)));
+    }
+    return ret;
+}
+
+}
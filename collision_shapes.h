@@ -0,0 +1,175 @@
+/*
+
+MIT License with AI exception
+
+Copyright (c) Tadeusz Puźniakowski 2024
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is furnished
+to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+Additional restriction:
+
+The Software may not be used, in whole or in part, to teach or train any
+artificial intelligence system, including but not limited to large language
+models (LLMs), neural networks, or any other type of AI technology. Violation of
+this restriction will be considered a breach of this License.
+
+*/
+
+
+
+#ifndef MCGGAME_COLLISION_SHAPES_H
+#define MCGGAME_COLLISION_SHAPES_H
+
+#include "engine.h"
+
+#include <string>
+#include <vector>
+
+namespace mcggame {
+
+enum class collision_mode_e {
+    PIXELS, ///< sample the collision points of the car in the collision bitmap
+    SAT,    ///< separating axis test of the car box against vectorized walls
+    FIXED   ///< like PIXELS, but the points are rotated in fixed point
+};
+
+collision_mode_e collision_mode_from_string(const std::string &name);
+std::string to_string(collision_mode_e mode);
+
+struct segment_t {
+    position_t a;
+    position_t b;
+};
+
+struct aabb_t {
+    position_t min;
+    position_t max;
+};
+
+/**
+ * @brief Rectangle rotated by angle around its center.
+ */
+struct oriented_box_t {
+    position_t center;
+    position_t half_size;
+    double angle;
+};
+
+/**
+ * @brief Walls of the race track as simplified polylines.
+ *
+ * The collision bitmap is vectorized with marching squares, the contours are
+ * simplified with Douglas-Peucker and the resulting segments are kept per
+ * square tile, each tile with its own bounding volume hierarchy. Tiles can be
+ * rebuilt one by one when the bitmap changes.
+ */
+class wall_shapes_c {
+public:
+    struct bvh_node_t {
+        aabb_t box;
+        int first;  ///< first segment (leaf) or left child (inner node)
+        int count;  ///< number of segments, 0 for inner nodes
+    };
+
+    struct tile_t {
+        std::vector<segment_t> segments;
+        std::vector<bvh_node_t> nodes; ///< nodes[0] is the root
+    };
+
+private:
+    int _tile_size;
+    int _tiles_w;
+    int _tiles_h;
+    double _simplify_epsilon;
+    std::vector<tile_t> _tiles;
+
+public:
+    /**
+     * @param collision_map bitmap where 255 means wall
+     * @param tile_size size of a tile in pixels
+     * @param simplify_epsilon maximal distance of the simplified contour from the marching squares one
+     */
+    wall_shapes_c(const logic_bitmap_t &collision_map, const int tile_size = 64, const double simplify_epsilon = 0.5);
+
+    /**
+     * @brief Vectorizes again the tile (tx,ty) from the current collision map.
+     */
+    void rebuild_tile(const logic_bitmap_t &collision_map, const int tx, const int ty);
+
+    /**
+     * @brief Rebuilds the tiles affected by a change of the pixels from (x0,y0) to (x1,y1), exclusive.
+     */
+    void rebuild_region(const logic_bitmap_t &collision_map, const int x0, const int y0, const int x1, const int y1);
+
+    /**
+     * @brief Returns contact points between the box and the walls.
+     *
+     * For every wall segment crossing the box it returns the middle of the
+     * part of the segment that is inside the box. When the box is entirely
+     * inside a wall, no segment crosses it, so the center is checked in the
+     * bitmap as well. Empty result means no collision.
+     *
+     * @param depths if not null, receives for every contact how deep the box
+     * is in the wall behind the segment, see segment_penetration
+     */
+    std::vector<position_t> check_collision(const oriented_box_t &box, const logic_bitmap_t &collision_map, std::vector<double> *depths = nullptr) const;
+
+    int tile_size() const { return _tile_size; }
+    int tiles_w() const { return _tiles_w; }
+    int tiles_h() const { return _tiles_h; }
+    const tile_t &tile(const int tx, const int ty) const { return _tiles[ty * _tiles_w + tx]; }
+    size_t segment_count() const;
+};
+
+/**
+ * @brief Marching squares over the cells of one tile. Cell (x,y) has corners
+ * in the centers of the pixels (x,y) and (x+1,y+1), so cells from -1 to w-1
+ * are needed to close the contours on the map border.
+ */
+std::vector<segment_t> marching_squares(const logic_bitmap_t &collision_map, const int cell_x0, const int cell_y0, const int cell_x1, const int cell_y1);
+
+/**
+ * @brief Joins segments sharing endpoints into polylines.
+ */
+std::vector<std::vector<position_t>> chain_segments(const std::vector<segment_t> &segments);
+
+std::vector<position_t> simplify_polyline(const std::vector<position_t> &polyline, const double epsilon);
+
+/**
+ * @brief Separating axis test between a box and a segment.
+ *
+ * @param box_axis_x unit vector of the box x axis
+ * @param box_axis_y unit vector of the box y axis
+ * @param contact receives the middle of the part of the segment inside the box
+ */
+bool box_segment_overlap(const oriented_box_t &box, const position_t &box_axis_x, const position_t &box_axis_y, const segment_t &segment, position_t &contact);
+
+/**
+ * @brief Penetration depth of a box overlapping a wall segment.
+ *
+ * The smallest distance the box has to move along one of the separating
+ * axes to leave the wall side of the segment; along the segment normal it is
+ * the depth of the deepest box corner behind the segment. The wall side is
+ * looked up in the collision map, because the contours keep no orientation.
+ */
+double segment_penetration(const oriented_box_t &box, const position_t &box_axis_x, const position_t &box_axis_y, const segment_t &segment, const logic_bitmap_t &collision_map);
+
+}
+
+#endif
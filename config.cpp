@@ -0,0 +1,255 @@
+/*
+
+MIT License with AI exception
+
+Copyright (c) Tadeusz Puźniakowski 2024
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is furnished
+to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+Additional restriction:
+
+The Software may not be used, in whole or in part, to teach or train any
+artificial intelligence system, including but not limited to large language
+models (LLMs), neural networks, or any other type of AI technology. Violation of
+this restriction will be considered a breach of this License.
+
+*/
+
+
+#include "config.h"
+
+#include <cmath>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <unistd.h>
+#include <errno.h>
+#endif
+
+namespace mcggame {
+
+static std::string trim(const std::string &s) {
+    auto b = s.find_first_not_of(" \t\r\n");
+    if (b == std::string::npos) return "";
+    auto e = s.find_last_not_of(" \t\r\n");
+    return s.substr(b, e - b + 1);
+}
+
+template <class T>
+static T parse_number(const std::string &key, const std::string &value) {
+    std::istringstream in(value);
+    T ret;
+    if (!(in >> ret) || !(in >> std::ws).eof()) throw std::invalid_argument(key + " should be a number, got \"" + value + "\"");
+    return ret;
+}
+
+/**
+ * @brief parse_number that also rejects values below min, so a reload can
+ * not hand the running game a value it can not use.
+ */
+template <class T>
+static T parse_at_least(const std::string &key, const std::string &value, const T min) {
+    T ret = parse_number<T>(key, value);
+    if (!(ret >= min)) {
+        std::ostringstream message;
+        message << key << " must be at least " << min << ", got \"" << value << "\"";
+        throw std::invalid_argument(message.str());
+    }
+    return ret;
+}
+
+static double parse_positive(const std::string &key, const std::string &value) {
+    double ret = parse_number<double>(key, value);
+    if (!(ret > 0.0) || !std::isfinite(ret)) throw std::invalid_argument(key + " must be positive, got \"" + value + "\"");
+    return ret;
+}
+
+static position_t parse_position(const std::string &key, const std::string &value) {
+    auto comma = value.find(',');
+    if (comma == std::string::npos) throw std::invalid_argument(key + " should be x,y, got \"" + value + "\"");
+    return {parse_number<double>(key, trim(value.substr(0, comma))), parse_number<double>(key, trim(value.substr(comma + 1)))};
+}
+
+void game_config_t::set(const std::string &key, const std::string &value) {
+    if (key == "config") {
+        config_file = value;
+    } else if (key == "track") {
+        track = value;
+    } else if (key == "car-texture") {
+        car_texture = value;
+    } else if (key == "spawn") {
+        // x,y;x,y;...
+        std::vector<position_t> positions;
+        std::istringstream in(value);
+        for (std::string p; std::getline(in, p, ';');)
+            if (trim(p).size() > 0) positions.push_back(parse_position(key, p));
+        if (positions.empty()) throw std::invalid_argument("spawn needs at least one position");
+        spawn = positions;
+    } else if (key == "dt") {
+        dt = parse_positive(key, value);
+    } else if (key == "substeps") {
+        simulation.substeps = parse_at_least<int>(key, value, 1);
+    } else if (key == "extra-friction") {
+        simulation.extra_friction = parse_at_least<double>(key, value, 0.0);
+    } else if (key == "repair-iterations") {
+        simulation.repair_iterations = parse_at_least<int>(key, value, 0);
+    } else if (key == "repair-position-step") {
+        simulation.repair_position_step = parse_positive(key, value);
+    } else if (key == "repair-angle-step") {
+        simulation.repair_angle_step = parse_positive(key, value);
+    } else if (key == "repair-budget") {
+        // 0 is unlimited
+        simulation.repair_budget = parse_at_least<int>(key, value, 0);
+    } else if (key == "repair-time-budget") {
+        simulation.repair_time_budget_us = parse_at_least<int>(key, value, 0);
+    } else if (key == "pacing") {
+        pacing = pacing_mode_from_string(value);
+    } else if (key == "collision") {
+        collision = collision_mode_from_string(value);
+    } else if (key == "physics") {
+        physics = physics_model_from_string(value);
+    } else if (key == "server") {
+        server_port = parse_at_least<int>(key, value, 0);
+        if (server_port > 65535) throw std::invalid_argument("server should be a port number, got \"" + value + "\"");
+    } else if (key == "connect") {
+        connect = value;
+    } else if (key == "room") {
+        room = parse_number<uint32_t>(key, value);
+    } else if (key == "snapshot-interval") {
+        snapshot_interval = parse_at_least<int>(key, value, 1);
+    } else if (key == "sprite-cache") {
+        // 0 rotates the sprite when drawing
+        sprite_cache = parse_at_least<int>(key, value, 0);
+    } else if (key == "export") {
+        export_to = value;
+    } else if (key == "export-frames") {
+        export_frames = parse_at_least<int>(key, value, 1);
+    } else if (key == "export-fps") {
+        export_fps = parse_at_least<int>(key, value, 1);
+    } else if (key == "export-size") {
+        auto x = value.find('x');
+        if (x == std::string::npos) throw std::invalid_argument("export size should be WIDTHxHEIGHT, got " + value);
+        export_width = parse_at_least<int>(key, value.substr(0, x), 1);
+        export_height = parse_at_least<int>(key, value.substr(x + 1), 1);
+    } else if (key == "views") {
+        views = (value == "auto") ? 0 : parse_at_least<int>(key, value, 0);
+    } else {
+        throw std::invalid_argument("unknown option: " + key);
+    }
+}
+
+void read_config(game_config_t &config, std::istream &in, const std::string &source) {
+    std::string line;
+    for (int n = 1; std::getline(in, line); n++) {
+        line = trim(line.substr(0, line.find('#')));
+        if (line.empty()) continue;
+        auto eq = line.find('=');
+        try {
+            if (eq == std::string::npos) throw std::invalid_argument("expected key = value");
+            config.set(trim(line.substr(0, eq)), trim(line.substr(eq + 1)));
+        } catch (const std::invalid_argument &e) {
+            throw std::invalid_argument(source + ":" + std::to_string(n) + ": " + e.what());
+        }
+    }
+}
+
+game_config_t load_config(const std::vector<std::string> &args) {
+    game_config_t config;
+    std::vector<std::pair<std::string, std::string>> overrides;
+    bool explicit_file = false;
+    for (const auto &arg : args) {
+        auto eq = arg.find('=');
+        if ((arg.rfind("--", 0) != 0) || (eq == std::string::npos)) throw std::invalid_argument("unknown argument: " + arg);
+        overrides.push_back({arg.substr(2, eq - 2), arg.substr(eq + 1)});
+        if (overrides.back().first == "config") {
+            config.config_file = overrides.back().second;
+            explicit_file = true;
+        }
+    }
+
+    std::ifstream file(config.config_file);
+    if (file) {
+        read_config(config, file, config.config_file);
+    } else if (explicit_file) {
+        throw std::invalid_argument("could not read the config file " + config.config_file);
+    }
+
+    for (const auto &[key, value] : overrides) {
+        try {
+            config.set(key, value);
+        } catch (const std::invalid_argument &e) {
+            throw std::invalid_argument("--" + key + ": " + e.what());
+        }
+    }
+    return config;
+}
+
+static std::filesystem::file_time_type modification_time(const std::filesystem::path &path) {
+    std::error_code ec;
+    auto t = std::filesystem::last_write_time(path, ec);
+    return ec ? std::filesystem::file_time_type::min() : t;
+}
+
+config_watcher_c::config_watcher_c(const std::string &path) : _path(path) {
+    _last_write = modification_time(_path);
+#ifdef __linux__
+    _inotify = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (_inotify < 0) throw std::runtime_error("inotify_init1 failed: " + std::to_string(errno));
+    auto directory = _path.has_parent_path() ? _path.parent_path() : std::filesystem::path(".");
+    // not IN_CREATE: a new file is still empty until it is closed, and the
+    // reload would reset every option to its default for a moment
+    if (inotify_add_watch(_inotify, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) < 0) {
+        close(_inotify);
+        throw std::runtime_error("could not watch " + directory.string());
+    }
+#endif
+}
+
+config_watcher_c::~config_watcher_c() {
+#ifdef __linux__
+    close(_inotify);
+#endif
+}
+
+bool config_watcher_c::changed() {
+#ifdef __linux__
+    bool ret = false;
+    alignas(inotify_event) char buffer[4096];
+    for (;;) {
+        auto n = read(_inotify, buffer, sizeof(buffer));
+        if (n <= 0) break;
+        for (char *p = buffer; p < buffer + n; ) {
+            auto *event = (inotify_event *)p;
+            if ((event->len > 0) && (_path.filename() == event->name)) ret = true;
+            p += sizeof(inotify_event) + event->len;
+        }
+    }
+    return ret;
+#else
+    auto t = modification_time(_path);
+    if (t == _last_write) return false;
+    _last_write = t;
+    return true;
+#endif
+}
+
+}
@@ -0,0 +1,131 @@
+/*
+
+MIT License with AI exception
+
+Copyright (c) Tadeusz Puźniakowski 2024
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is furnished
+to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+Additional restriction:
+
+The Software may not be used, in whole or in part, to teach or train any
+artificial intelligence system, including but not limited to large language
+models (LLMs), neural networks, or any other type of AI technology. Violation of
+this restriction will be considered a breach of this License.
+
+*/
+
+
+#ifndef MCGGAME_CONFIG_H
+#define MCGGAME_CONFIG_H
+
+#include "game.h"
+#include "frame_pacer.h"
+
+#include <filesystem>
+#include <istream>
+#include <string>
+#include <vector>
+
+namespace mcggame {
+
+/**
+ * @brief Everything that can be set from the config file or the command line.
+ *
+ * The config file has one "key = value" per line, # starts a comment. The
+ * keys are the command line options without the leading "--", so
+ * "physics = drift" in the file is the same as --physics=drift, and the
+ * command line wins over the file.
+ *
+ * physics, substeps, extra-friction and the repair-* keys are applied by
+ * the running simulation when the file changes; the rest is read at start.
+ */
+struct game_config_t {
+    std::string config_file = "mcggame.conf"; ///< read when it exists, unless --config names another file
+    std::string track = "assets/map_01.bmp";
+    std::string car_texture = "assets/car_01.bmp";
+    std::vector<position_t> spawn = {{100.0, 100.0}, {180.0, 100.0}}; ///< where the cars start, moved out of the walls if needed
+    double dt = 0.01;             ///< simulation tick in seconds
+    simulation_params_t simulation;
+
+    pacing_mode_e pacing = pacing_mode_e::VSYNC;
+    collision_mode_e collision = collision_mode_e::PIXELS;
+    car_physics_fn physics = &arcade_physics::step;
+    int server_port = 0;          ///< run the headless server on this port
+    std::string connect;          ///< host:port of the server to play on
+    uint32_t room = 1;
+    int snapshot_interval = 2;    ///< server ticks between snapshots
+    int views = 0;                ///< 0 splits the screen only when the cars are far apart
+    int sprite_cache = 0;         ///< pre-rotated car frames, 0 rotates them when drawing
+    std::string export_to;        ///< render offscreen to "-" (raw frames on stdout) or a BMP file name pattern
+    int export_frames = 300;
+    int export_fps = 30;
+    int export_width = game_view_width;
+    int export_height = game_view_height;
+
+    /**
+     * @brief Sets one option, e.g. set("physics", "drift").
+     *
+     * Throws std::invalid_argument for unknown keys, malformed values and
+     * values out of their range, e.g. a zero export-fps or negative views.
+     */
+    void set(const std::string &key, const std::string &value);
+};
+
+/**
+ * @brief Reads "key = value" lines into the config. Errors name the source
+ * and the line.
+ */
+void read_config(game_config_t &config, std::istream &in, const std::string &source);
+
+/**
+ * @brief The defaults, then the config file, then the arguments.
+ *
+ * args are the command line arguments without the program name. An explicit
+ * --config file has to exist, the default one is optional.
+ */
+game_config_t load_config(const std::vector<std::string> &args);
+
+/**
+ * @brief Tells when the config file was written.
+ *
+ * Uses inotify on Linux and watches the directory, so editors that save by
+ * renaming a new file over the old one are noticed too. Elsewhere it
+ * compares the modification time. changed() never blocks, call it once a
+ * frame or so.
+ */
+class config_watcher_c {
+    std::filesystem::path _path;
+    int _inotify = -1;
+    std::filesystem::file_time_type _last_write;
+public:
+    config_watcher_c(const std::string &path);
+    config_watcher_c(const config_watcher_c &) = delete;
+    config_watcher_c &operator=(const config_watcher_c &) = delete;
+    virtual ~config_watcher_c();
+
+    /**
+     * @brief true once after every change of the file
+     */
+    bool changed();
+};
+
+}
+
+#endif
@@ -38,12 +38,20 @@ this restriction will be considered a breach of this License.
 
 namespace mcggame {
 
-game_context_c::game_context_c(){
+game_context_c::game_context_c(const bool vsync){
     if (SDL_Init(SDL_INIT_VIDEO | SDL_INIT_GAMECONTROLLER | SDL_INIT_JOYSTICK) < 0) {
         throw std::runtime_error(SDL_GetError());
     }
 
-    if (SDL_CreateWindowAndRenderer(800, 500, SDL_WINDOW_RESIZABLE, &window, &renderer)) {
+    window = SDL_CreateWindow("mcggame", SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED, 800, 500, SDL_WINDOW_RESIZABLE);
+    if (!window) {
+        throw std::runtime_error(SDL_GetError());
+    }
+
+    Uint32 flags = vsync ? SDL_RENDERER_PRESENTVSYNC : 0;
+    renderer = SDL_CreateRenderer(window, -1, SDL_RENDERER_ACCELERATED | flags);
+    if (!renderer) renderer = SDL_CreateRenderer(window, -1, flags);
+    if (!renderer) {
         throw std::runtime_error(SDL_GetError());
     }
 
@@ -58,6 +66,19 @@ game_context_c::~game_context_c() {
     SDL_Quit();
 }
 
+bool game_context_c::vsync() const {
+    SDL_RendererInfo info;
+    if (SDL_GetRendererInfo(renderer, &info)) return false;
+    return info.flags & SDL_RENDERER_PRESENTVSYNC;
+}
+
+int game_context_c::refresh_rate() const {
+    SDL_DisplayMode mode;
+    int display = SDL_GetWindowDisplayIndex(window);
+    if ((display < 0) || SDL_GetCurrentDisplayMode(display, &mode)) return 0;
+    return mode.refresh_rate;
+}
+
 void game_context(const std::function<void(SDL_Renderer *renderer)> &game_main) {
     SDL_Window *window;
     SDL_Renderer *renderer;
@@ -83,6 +104,21 @@ void game_context(const std::function<void(SDL_Renderer *renderer)> &game_main)
 
 
 
+std::vector<unsigned char> get_pixel(SDL_Surface *surface, int x, int y) {
+    std::vector<unsigned char> ret;   
+    SDL_PixelFormat *format = surface->format;
+    if (x >= surface->w) throw std::invalid_argument("x should be lower than surface width");
+    if (y >= surface->h) throw std::invalid_argument("y should be lower than surface width");
+    if (x < 0) throw std::invalid_argument("x should be non negative");
+    if (y < 0) throw std::invalid_argument("y should be non negative");
+    int bpp = format->BytesPerPixel;
+    int pitch = surface->pitch;
+    unsigned char* pixel_data = (unsigned char*)surface->pixels;
+    unsigned char* row = pixel_data + (pitch*y);
+    for (int i = 0; i < format->BytesPerPixel; i++) ret.push_back(*(row+(x*bpp+i)));
+    return ret;
+}
+
 position_t operator+(const position_t &a, const position_t &b) {
     return {a[0]+b[0],a[1]+b[1]};
 }
@@ -127,8 +163,14 @@ position_t rotate_around(const position_t &p, const double &angle, const positio
 double angle_crop_to_range(double a) {
     if (a < -M_PI) a = a+M_PI*2.0;
     if (a >= M_PI) a = a-M_PI*2.0;
-    // if (std::abs(a) > std::abs(a + 2.0*M_PI)) a = a + 2.0*M_PI;
-    // if (std::abs(a) > std::abs(a - 2.0*M_PI)) a = a - 2.0*M_PI;
+    // one wrap is enough for the sum or difference of two cropped angles,
+    // anything further away is reduced the slow way
+    if ((a < -M_PI) || (a >= M_PI)) {
+        a = std::fmod(a + M_PI, M_PI*2.0);
+        if (a < 0.0) a = a+M_PI*2.0;
+        a = a-M_PI;
+        if (a >= M_PI) a = -M_PI;
+    }
     return a;
 }
 
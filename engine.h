@@ -41,6 +41,8 @@ this restriction will be considered a breach of this License.
 #include <functional>
 #include <array>
 #include <ostream>
+#include <vector>
+#include <sys/types.h>
 
 
 
@@ -70,19 +72,111 @@ double angle_between_vectors(const position_t& v1,
                               const position_t& v2);
 double angle_between_shapes(const std::vector<position_t>& shape1,
                               const std::vector<position_t>& shape2);
+/**
+ * @brief The same angle in the range [-pi, pi).
+ */
 double angle_crop_to_range(double a);
 
 std::array<position_t,3> update_phys_point(position_t p, position_t v, position_t a, const double dt);
 position_t calculate_friction_acceleration(position_t v, const double coefficient) ;
 
+/**
+ * @brief Plain physical state of a car, without textures or inputs. It is
+ * cheap to copy, so it is what the simulation publishes for rendering.
+ */
+struct car_state_t {
+    position_t p;
+    position_t v;
+    position_t a;
+    double angle;
+};
+
+struct input_state_t {
+    position_t p;
+};
+
+
+std::vector<unsigned char> get_pixel(SDL_Surface *surface, int x, int y);
+
+struct logic_bitmap_t {
+    int w;
+    int h;
+    std::vector<unsigned char> bitmap;
+    unsigned char &operator()(const int x, const int y){
+        static unsigned char placeholder = 0;
+        if ( (x >= 0) && (x < (w)) &&
+                 (y >= 0) && (y < (h)) ) return bitmap[y*w+x];
+        else
+            return placeholder;
+    }
+    unsigned char operator()(const int x, const int y) const {
+        if ( (x >= 0) && (x < (w)) &&
+                 (y >= 0) && (y < (h)) ) return bitmap[y*w+x];
+        else
+            return 0;
+    }
+
+    static logic_bitmap_t from_surface(SDL_Surface *surface, std::function<unsigned char(int x, int y, u_int64_t v)> callback = [](int x, int y, u_int64_t v){return (unsigned char)(v&0x0ff);}) {
+        logic_bitmap_t ret;
+        ret.w = surface->w;
+        ret.h = surface->h;
+        ret.bitmap.reserve(ret.w*ret.h);
+        for (int y = 0; y < surface->h; ++y) {
+            for (int x = 0; x < surface->w; ++x) {
+                unsigned char attr = 255;
+                auto p = get_pixel(surface, x, y);
+                for (int i = 0; i < 4-p.size(); i++) p.push_back(0);
+                u_int64_t *p_p = (u_int64_t *)p.data();
+                attr = callback(x,y,*p_p);
+                ret.bitmap.push_back(attr);
+            }
+        }
+
+        return ret;
+    }
+};
+
+/**
+ * @brief Something the renderer draws into: the window, or a surface in memory.
+ */
+class render_target_i {
+public:
+    virtual SDL_Renderer *get_renderer() const = 0;
 
-class game_context_c {
+    /**
+     * @brief Finishes the frame drawn since the last present.
+     */
+    virtual void present() = 0;
+
+    virtual ~render_target_i() {}
+};
+
+class game_context_c : public render_target_i {
     SDL_Window *window;
 public:
     SDL_Renderer *renderer;
 
-    game_context_c();
+    /**
+     * @brief Creates the window and the renderer.
+     *
+     * @param vsync ask the renderer to wait for the vertical retrace in SDL_RenderPresent
+     */
+    game_context_c(const bool vsync = true);
     virtual ~game_context_c();
+
+    /**
+     * @brief true if the renderer actually presents with vsync
+     */
+    bool vsync() const;
+
+    /**
+     * @brief refresh rate of the display showing the window, 0 if unknown
+     */
+    int refresh_rate() const;
+
+    SDL_Renderer *get_renderer() const {return renderer; }
+
+    void present() {SDL_RenderPresent(renderer); }
 };
 
 }
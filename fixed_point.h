@@ -0,0 +1,258 @@
+/*
+
+MIT License with AI exception
+
+Copyright (c) Tadeusz Puźniakowski 2024
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is furnished
+to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+Additional restriction:
+
+The Software may not be used, in whole or in part, to teach or train any
+artificial intelligence system, including but not limited to large language
+models (LLMs), neural networks, or any other type of AI technology. Violation of
+this restriction will be considered a breach of this License.
+
+*/
+
+
+
+#ifndef MCGGAME_FIXED_POINT_H
+#define MCGGAME_FIXED_POINT_H
+
+#include "engine.h"
+
+#include <array>
+#include <cmath>
+#include <cstdint>
+
+namespace mcggame {
+namespace fixed {
+
+/*
+ * Integer math backend for deterministic simulation.
+ *
+ * Numbers are signed 32.32 fixed point, angles are binary angles where the
+ * full turn is 2^32, so they wrap around for free. Trigonometry comes from
+ * a table computed by the compiler, atan2 is CORDIC and sqrt is the exact
+ * integer root, so no result depends on libm. Numbers convert from and to
+ * double exactly in the ranges the game uses; angles convert with a single
+ * multiplication, which IEEE rounds the same way everywhere.
+ */
+
+struct fixed_t {
+    int64_t raw;
+
+    static constexpr int fraction_bits = 32;
+    static constexpr int64_t one_raw = int64_t(1) << fraction_bits;
+
+    static constexpr fixed_t from_raw(const int64_t r) { return {r}; }
+    static constexpr fixed_t from_int(const int64_t i) { return {i * one_raw}; }
+    /**
+     * @brief Rounded to the nearest 2^-32, exact for doubles that have at most 32 fraction bits.
+     */
+    static constexpr fixed_t from_double(const double d) { return {(int64_t)(d * (double)one_raw + ((d < 0.0) ? -0.5 : 0.5))}; }
+    constexpr double to_double() const { return (double)raw / (double)one_raw; }
+};
+
+constexpr fixed_t operator+(const fixed_t a, const fixed_t b) { return {a.raw + b.raw}; }
+constexpr fixed_t operator-(const fixed_t a, const fixed_t b) { return {a.raw - b.raw}; }
+constexpr fixed_t operator-(const fixed_t a) { return {-a.raw}; }
+/// rounds towards minus infinity
+constexpr fixed_t operator*(const fixed_t a, const fixed_t b) { return {(int64_t)(((__int128)a.raw * b.raw) >> fixed_t::fraction_bits)}; }
+/// rounds towards zero
+constexpr fixed_t operator/(const fixed_t a, const fixed_t b) { return {(int64_t)(((__int128)a.raw << fixed_t::fraction_bits) / b.raw)}; }
+constexpr bool operator<(const fixed_t a, const fixed_t b) { return a.raw < b.raw; }
+constexpr bool operator>(const fixed_t a, const fixed_t b) { return a.raw > b.raw; }
+constexpr bool operator<=(const fixed_t a, const fixed_t b) { return a.raw <= b.raw; }
+constexpr bool operator>=(const fixed_t a, const fixed_t b) { return a.raw >= b.raw; }
+constexpr bool operator==(const fixed_t a, const fixed_t b) { return a.raw == b.raw; }
+constexpr bool operator!=(const fixed_t a, const fixed_t b) { return a.raw != b.raw; }
+
+/**
+ * @brief Largest r with r*r <= n. The floating point square root is only
+ * the first guess, the integer corrections make the result exact whatever
+ * the guess was.
+ */
+inline uint64_t isqrt(const unsigned __int128 n) {
+    uint64_t r = (uint64_t)std::sqrt((double)n);
+    while ((unsigned __int128)r*r > n) r--;
+    while ((unsigned __int128)(r + 1)*(r + 1) <= n) r++;
+    return r;
+}
+
+/// rounds down, 0 for negative numbers
+inline fixed_t sqrt(const fixed_t v) {
+    if (v.raw <= 0) return {0};
+    return {(int64_t)isqrt((unsigned __int128)v.raw << fixed_t::fraction_bits)};
+}
+
+struct fixed_vec_t {
+    fixed_t x;
+    fixed_t y;
+
+    static fixed_vec_t from_position(const position_t &p) { return {fixed_t::from_double(p[0]), fixed_t::from_double(p[1])}; }
+    position_t to_position() const { return {x.to_double(), y.to_double()}; }
+};
+
+constexpr fixed_vec_t operator+(const fixed_vec_t &a, const fixed_vec_t &b) { return {a.x + b.x, a.y + b.y}; }
+constexpr fixed_vec_t operator-(const fixed_vec_t &a, const fixed_vec_t &b) { return {a.x - b.x, a.y - b.y}; }
+constexpr fixed_vec_t operator*(const fixed_vec_t &a, const fixed_t b) { return {a.x * b, a.y * b}; }
+inline fixed_t length(const fixed_vec_t &v) { return sqrt(v.x*v.x + v.y*v.y); }
+
+using angle_t = uint32_t;  ///< 2^32 is the full turn
+const angle_t half_turn = 0x80000000u;
+const angle_t quarter_turn = 0x40000000u;
+
+constexpr double pi = 3.14159265358979323846;
+constexpr double angle_units_per_radian = 4294967296.0 / (2.0*pi);
+constexpr double radians_per_angle_unit = (2.0*pi) / 4294967296.0;
+
+/**
+ * @brief Nearest binary angle; the multiplication is the only floating point operation.
+ */
+inline angle_t angle_from_radians(const double a) {
+    return (angle_t)(uint64_t)std::llround(a * angle_units_per_radian);
+}
+
+/**
+ * @brief The angle in radians, in the range [-pi, pi).
+ */
+inline double angle_to_radians(const angle_t a) {
+    return (int32_t)a * radians_per_angle_unit;
+}
+
+namespace detail {
+
+/// Taylor series, only for the tables made at compile time
+constexpr double sin_series(double x) {
+    if (x > pi) x -= 2.0*pi;
+    double term = x;
+    double sum = x;
+    for (int n = 1; n < 30; n++) {
+        term = -term * x * x / ((2*n) * (2*n + 1));
+        sum += term;
+    }
+    return sum;
+}
+
+constexpr double atan_series(const double x) {
+    double power = x;
+    double sum = 0.0;
+    for (int n = 0; n < 60; n++) {
+        sum += ((n % 2) ? -power : power) / (2*n + 1);
+        power *= x * x;
+    }
+    return sum;
+}
+
+constexpr int sin_table_bits = 12;
+constexpr int sin_table_size = 1 << sin_table_bits;
+
+constexpr std::array<int64_t, sin_table_size + 1> make_sin_table() {
+    std::array<int64_t, sin_table_size + 1> table = {};
+    for (int i = 0; i <= sin_table_size; i++)
+        table[i] = fixed_t::from_double(sin_series(2.0*pi*i/sin_table_size)).raw;
+    return table;
+}
+
+constexpr int cordic_iterations = 31;
+
+constexpr std::array<angle_t, cordic_iterations> make_atan_table() {
+    std::array<angle_t, cordic_iterations> table = {};
+    table[0] = quarter_turn / 2;  // atan(1) is exactly the eighth of the turn
+    double x = 1.0;
+    for (int i = 1; i < cordic_iterations; i++) {
+        x *= 0.5;
+        table[i] = (angle_t)(atan_series(x) * angle_units_per_radian + 0.5);
+    }
+    return table;
+}
+
+constexpr auto sin_table = make_sin_table();
+constexpr auto atan_table = make_atan_table();
+
+}
+
+/**
+ * @brief Sine from the table, linearly interpolated between its entries.
+ */
+inline fixed_t sin(const angle_t a) {
+    constexpr int shift = 32 - detail::sin_table_bits;
+    uint32_t index = a >> shift;
+    int64_t part = a & ((1u << shift) - 1);
+    int64_t s0 = detail::sin_table[index];
+    int64_t s1 = detail::sin_table[index + 1];
+    return {s0 + (((s1 - s0) * part) >> shift)};
+}
+
+inline fixed_t cos(const angle_t a) {
+    return sin(a + quarter_turn);
+}
+
+/**
+ * @brief Direction of (x,y) by CORDIC, 0 for the zero vector.
+ */
+inline angle_t atan2(const fixed_t y, const fixed_t x) {
+    int64_t vx = x.raw;
+    int64_t vy = y.raw;
+    if ((vx == 0) && (vy == 0)) return 0;
+    angle_t a = 0;
+    // turn into the right half plane, where CORDIC converges
+    if (vx < 0) {
+        vx = -vx;
+        vy = -vy;
+        a = half_turn;
+    }
+    // use all the bits, small vectors would lose precision in the shifts
+    uint64_t m = (uint64_t)vx | (uint64_t)((vy < 0) ? -vy : vy);
+    int headroom = __builtin_clzll(m) - 3;
+    if (headroom > 0) {
+        vx <<= headroom;
+        vy <<= headroom;
+    } else if (headroom < 0) {
+        vx >>= -headroom;
+        vy >>= -headroom;
+    }
+    for (int i = 0; i < detail::cordic_iterations; i++) {
+        int64_t dx = vx >> i;
+        int64_t dy = vy >> i;
+        if (vy > 0) {
+            vx += dy;
+            vy -= dx;
+            a += detail::atan_table[i];
+        } else {
+            vx -= dy;
+            vy += dx;
+            a -= detail::atan_table[i];
+        }
+    }
+    return a;
+}
+
+inline fixed_vec_t rotate(const fixed_vec_t &v, const angle_t a) {
+    fixed_t c = cos(a);
+    fixed_t s = sin(a);
+    return {v.x*c - v.y*s, v.x*s + v.y*c};
+}
+
+}
+}
+
+#endif
@@ -0,0 +1,151 @@
+/*
+
+MIT License with AI exception
+
+Copyright (c) Tadeusz Puźniakowski 2024
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is furnished
+to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+Additional restriction:
+
+The Software may not be used, in whole or in part, to teach or train any
+artificial intelligence system, including but not limited to large language
+models (LLMs), neural networks, or any other type of AI technology. Violation of
+this restriction will be considered a breach of this License.
+
+*/
+
+#include "frame_pacer.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <thread>
+
+#ifdef __linux__
+#include <time.h>
+#include <errno.h>
+#endif
+
+namespace mcggame {
+
+/// how many frame times are kept for the percentiles
+static const size_t frame_history_size = 1024;
+
+pacing_mode_e pacing_mode_from_string(const std::string &name) {
+    if (name == "sleep") return pacing_mode_e::SLEEP;
+    if (name == "vsync") return pacing_mode_e::VSYNC;
+    if (name == "spin") return pacing_mode_e::SPIN;
+    if (name == "adaptive") return pacing_mode_e::ADAPTIVE;
+    throw std::invalid_argument("unknown pacing mode: " + name);
+}
+
+std::string to_string(pacing_mode_e mode) {
+    switch (mode) {
+        case pacing_mode_e::SLEEP: return "sleep";
+        case pacing_mode_e::VSYNC: return "vsync";
+        case pacing_mode_e::SPIN: return "spin";
+        case pacing_mode_e::ADAPTIVE: return "adaptive";
+    }
+    return "unknown";
+}
+
+void sleep_until_precise(frame_pacer_c::clock::time_point t) {
+#ifdef __linux__
+    // steady_clock is CLOCK_MONOTONIC in libstdc++ and libc++
+    auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(t.time_since_epoch()).count();
+    if (ns <= 0) return;
+    timespec ts;
+    ts.tv_sec = ns / 1000000000;
+    ts.tv_nsec = ns % 1000000000;
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, nullptr) == EINTR) {
+    }
+#else
+    std::this_thread::sleep_until(t);
+#endif
+}
+
+std::ostream &operator<<(std::ostream &o, const frame_stats_t &s) {
+    o << "frames: " << s.frames << " p50: " << s.p50 << "ms p90: " << s.p90 << "ms p99: " << s.p99 << "ms max: " << s.max << "ms";
+    return o;
+}
+
+frame_pacer_c::frame_pacer_c(pacing_mode_e mode, clock::duration period) :
+    _mode(mode), _period(period), _spin_margin(std::chrono::microseconds(1000)), _frame_count(0) {
+    if (period <= clock::duration::zero()) throw std::invalid_argument("frame period must be positive");
+    _last_frame = clock::now();
+    _next_frame = _last_frame + _period;
+    _frame_times.reserve(frame_history_size);
+}
+
+void frame_pacer_c::record_frame(clock::time_point now) {
+    double ms = std::chrono::duration<double, std::milli>(now - _last_frame).count();
+    if (_frame_times.size() < frame_history_size) _frame_times.push_back(ms);
+    else _frame_times[_frame_count % frame_history_size] = ms;
+    _frame_count++;
+    _last_frame = now;
+}
+
+void frame_pacer_c::wait_for_next_frame() {
+    using namespace std::chrono;
+    switch (_mode) {
+        case pacing_mode_e::VSYNC:
+            break;
+        case pacing_mode_e::SLEEP:
+            sleep_until_precise(_next_frame);
+            break;
+        case pacing_mode_e::SPIN:
+            sleep_until_precise(_next_frame - _spin_margin);
+            while (clock::now() < _next_frame) {
+            }
+            break;
+        case pacing_mode_e::ADAPTIVE: {
+            auto wake_target = _next_frame - _spin_margin;
+            sleep_until_precise(wake_target);
+            auto oversleep = clock::now() - wake_target;
+            // grow quickly when the scheduler was late, shrink slowly when it was on time
+            if (oversleep > _spin_margin / 2) _spin_margin = std::min<clock::duration>(_spin_margin * 2, _period / 2);
+            else _spin_margin = std::max<clock::duration>(_spin_margin - _spin_margin / 16, microseconds(50));
+            while (clock::now() < _next_frame) {
+            }
+            break;
+        }
+    }
+    auto now = clock::now();
+    record_frame(now);
+    _next_frame += _period;
+    // after a long stall start again from now instead of rushing the missed frames
+    if (_next_frame < now) _next_frame = now + _period;
+}
+
+frame_stats_t frame_pacer_c::stats() const {
+    frame_stats_t ret = {_frame_times.size(), 0.0, 0.0, 0.0, 0.0};
+    if (_frame_times.empty()) return ret;
+    std::vector<double> sorted = _frame_times;
+    std::sort(sorted.begin(), sorted.end());
+    auto percentile = [&](double p) {
+        return sorted[std::min(sorted.size() - 1, (size_t)(p * (sorted.size() - 1) + 0.5))];
+    };
+    ret.p50 = percentile(0.50);
+    ret.p90 = percentile(0.90);
+    ret.p99 = percentile(0.99);
+    ret.max = sorted.back();
+    return ret;
+}
+
+}
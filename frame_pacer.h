@@ -0,0 +1,112 @@
+/*
+
+MIT License with AI exception
+
+Copyright (c) Tadeusz Puźniakowski 2024
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is furnished
+to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+Additional restriction:
+
+The Software may not be used, in whole or in part, to teach or train any
+artificial intelligence system, including but not limited to large language
+models (LLMs), neural networks, or any other type of AI technology. Violation of
+this restriction will be considered a breach of this License.
+
+*/
+
+
+
+#ifndef MCGGAME_FRAME_PACER_H
+#define MCGGAME_FRAME_PACER_H
+
+#include <chrono>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace mcggame {
+
+enum class pacing_mode_e {
+    SLEEP,     ///< sleep until the next frame, as precise as the scheduler allows
+    VSYNC,     ///< SDL_RenderPresent waits for the display, the pacer only measures
+    SPIN,      ///< sleep most of the frame, then busy-wait the fixed tail
+    ADAPTIVE   ///< like SPIN, but the tail follows the measured oversleep
+};
+
+pacing_mode_e pacing_mode_from_string(const std::string &name);
+std::string to_string(pacing_mode_e mode);
+
+struct frame_stats_t {
+    size_t frames; ///< number of frames in the sample window
+    double p50;    ///< frame time percentiles in milliseconds
+    double p90;
+    double p99;
+    double max;
+};
+
+std::ostream &operator<<(std::ostream &o, const frame_stats_t &s);
+
+/**
+ * @brief Keeps a loop running at a fixed period and measures how well it does.
+ *
+ * Call wait_for_next_frame() once per frame, after the frame is done
+ * (for VSYNC this is right after SDL_RenderPresent).
+ */
+class frame_pacer_c {
+public:
+    using clock = std::chrono::steady_clock;
+
+private:
+    pacing_mode_e _mode;
+    clock::duration _period;
+    clock::time_point _next_frame;
+    clock::time_point _last_frame;
+    clock::duration _spin_margin;
+
+    std::vector<double> _frame_times;   ///< ring buffer of frame times in ms
+    size_t _frame_count;
+
+    void record_frame(clock::time_point now);
+
+public:
+    frame_pacer_c(pacing_mode_e mode, clock::duration period);
+
+    void wait_for_next_frame();
+
+    pacing_mode_e mode() const { return _mode; }
+    clock::duration period() const { return _period; }
+    size_t frame_count() const { return _frame_count; }
+
+    /**
+     * @brief Frame time percentiles of the last frames (up to the size of the ring buffer).
+     */
+    frame_stats_t stats() const;
+};
+
+/**
+ * @brief Sleeps until the absolute time t. On Linux this uses
+ * clock_nanosleep with TIMER_ABSTIME on the monotonic clock, so the wakeup
+ * does not drift by the time it took to compute the remaining interval.
+ */
+void sleep_until_precise(frame_pacer_c::clock::time_point t);
+
+}
+
+#endif
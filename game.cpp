@@ -0,0 +1,679 @@
+/*
+
+MIT License with AI exception
+
+Copyright (c) Tadeusz Puźniakowski 2024
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is furnished
+to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+Additional restriction:
+
+The Software may not be used, in whole or in part, to teach or train any
+artificial intelligence system, including but not limited to large language
+models (LLMs), neural networks, or any other type of AI technology. Violation of
+this restriction will be considered a breach of this License.
+
+*/
+
+#include "game.h"
+#include <stdexcept>
+#include <iostream>
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
+namespace mcggame {
+
+std::shared_ptr<SDL_Surface> decode_bmp(const std::string fname) {
+        SDL_Surface *surface;
+        surface = SDL_LoadBMP(fname.c_str());
+        if (!surface) {
+            throw std::runtime_error(SDL_GetError());
+        }
+        SDL_SetColorKey(surface, SDL_TRUE, 0x0ffff);
+        return std::shared_ptr<SDL_Surface>(surface, [](auto p){SDL_FreeSurface(p);});
+}
+
+std::shared_ptr<SDL_Texture> upload_texture(SDL_Renderer *_renderer, SDL_Surface *surface) {
+        auto _track_tex = SDL_CreateTextureFromSurface(_renderer, surface);
+        if (!_track_tex) {
+            throw std::runtime_error(SDL_GetError());
+        }
+        return std::shared_ptr<SDL_Texture>(_track_tex, [](auto p){SDL_DestroyTexture(p);});
+}
+
+std::shared_ptr<SDL_Texture> load_texture(SDL_Renderer *_renderer, const std::string fname, std::function<void(SDL_Surface *)> callback) {
+        auto surface = decode_bmp(fname);
+        callback(surface.get());
+        if (!_renderer) {
+            // headless, e.g. the server: only the callback needs the pixels
+            return nullptr;
+        }
+        return upload_texture(_renderer, surface.get());
+}
+
+track_asset_t track_asset_t::decode(const std::string fname, const bool vectorize_walls) {
+    track_asset_t ret;
+    auto surface = decode_bmp(fname);
+    ret.collision_map = logic_bitmap_t::from_surface(surface.get(), [](int x, int y, u_int64_t v){
+        v = v & 0x0ffffff;
+        if (v == 0x000ffff) {
+            return 0; // no collision
+        }
+        return 255; // collision
+    });
+    ret.surface = std::shared_ptr<SDL_Surface>(SDL_ConvertSurfaceFormat(surface.get(), SDL_PIXELFORMAT_ARGB8888, 0), [](auto p){SDL_FreeSurface(p);});
+    if (!ret.surface) {
+        throw std::runtime_error(SDL_GetError());
+    }
+    if (vectorize_walls) ret.wall_shapes = std::make_shared<wall_shapes_c>(ret.collision_map);
+    return ret;
+}
+
+race_track_t::race_track_t(const track_asset_t &asset, SDL_Renderer *renderer) {
+    _renderer = renderer;
+    _collision_map = asset.collision_map;
+    // edits change the walls, so every track has its own copy
+    if (asset.wall_shapes) _wall_shapes = std::make_shared<wall_shapes_c>(*asset.wall_shapes);
+    _track_surface = asset.surface;
+    _track_tex = nullptr;
+    if (!_renderer) return;
+
+    _track_tex_p = upload_texture(_renderer, asset.surface.get());
+    _track_tex = _track_tex_p.get();
+
+    // SDL_UpdateTexture takes pixels in the format of the texture, and the
+    // render thread paints edits into this surface, so it is a private copy
+    Uint32 format;
+    SDL_QueryTexture(_track_tex, &format, nullptr, nullptr, nullptr);
+    _track_surface = std::shared_ptr<SDL_Surface>(SDL_ConvertSurfaceFormat(asset.surface.get(), format, 0), [](auto p){SDL_FreeSurface(p);});
+    if (!_track_surface) {
+        throw std::runtime_error(SDL_GetError());
+    }
+}
+
+/**
+ * @brief Pixels covered by the brush, clipped to w x h.
+ */
+static SDL_Rect track_edit_rect(const track_edit_t &edit, const int w, const int h) {
+    int x0 = std::max(0, (int)std::floor(edit.center[0] - edit.radius));
+    int y0 = std::max(0, (int)std::floor(edit.center[1] - edit.radius));
+    int x1 = std::min(w, (int)std::ceil(edit.center[0] + edit.radius) + 1);
+    int y1 = std::min(h, (int)std::ceil(edit.center[1] + edit.radius) + 1);
+    return {x0, y0, std::max(0, x1 - x0), std::max(0, y1 - y0)};
+}
+
+static bool track_edit_covers(const track_edit_t &edit, const int x, const int y) {
+    double dx = x + 0.5 - edit.center[0];
+    double dy = y + 0.5 - edit.center[1];
+    return dx*dx + dy*dy <= edit.radius*edit.radius;
+}
+
+void race_track_t::request_edit(const track_edit_t &edit) {
+    std::lock_guard<std::mutex> lock(_edits_mutex);
+    _requested_edits.push_back(edit);
+}
+
+bool race_track_t::apply_edit_requests() {
+    std::vector<track_edit_t> edits;
+    {
+        std::lock_guard<std::mutex> lock(_edits_mutex);
+        edits.swap(_requested_edits);
+    }
+    for (const auto &edit : edits) apply_edit(edit);
+    return edits.size() > 0;
+}
+
+void race_track_t::apply_edit(const track_edit_t &edit) {
+    auto rect = track_edit_rect(edit, width(), height());
+    if ((rect.w == 0) || (rect.h == 0)) return;
+    unsigned char value = edit.wall ? 255 : 0;
+    for (int y = rect.y; y < rect.y + rect.h; y++)
+        for (int x = rect.x; x < rect.x + rect.w; x++)
+            if (track_edit_covers(edit, x, y)) _collision_map(x, y) = value;
+    _collision_generation++;
+    if (_wall_shapes) _wall_shapes->rebuild_region(_collision_map, rect.x, rect.y, rect.x + rect.w, rect.y + rect.h);
+    if (!_renderer) return;
+
+    std::lock_guard<std::mutex> lock(_edits_mutex);
+    _applied_edits.push_back(edit);
+}
+
+void race_track_t::upload_dirty_regions() {
+    std::vector<track_edit_t> edits;
+    {
+        std::lock_guard<std::mutex> lock(_edits_mutex);
+        edits.swap(_applied_edits);
+    }
+    if (edits.empty()) return;
+
+    SDL_Surface *surface = _track_surface.get();
+    int bpp = surface->format->BytesPerPixel;
+    Uint32 wall_color = SDL_MapRGBA(surface->format, 0x80, 0x80, 0x80, 0xff);
+    Uint32 road_color = SDL_MapRGBA(surface->format, 0x00, 0xff, 0xff, 0x00);
+
+    std::vector<SDL_Rect> dirty;
+    if (SDL_MUSTLOCK(surface)) SDL_LockSurface(surface);
+    for (const auto &edit : edits) {
+        auto rect = track_edit_rect(edit, surface->w, surface->h);
+        if ((rect.w == 0) || (rect.h == 0)) continue;
+        Uint32 color = edit.wall ? wall_color : road_color;
+        for (int y = rect.y; y < rect.y + rect.h; y++) {
+            unsigned char *row = (unsigned char *)surface->pixels + surface->pitch*y;
+            for (int x = rect.x; x < rect.x + rect.w; x++)
+                if (track_edit_covers(edit, x, y)) std::memcpy(row + x*bpp, &color, bpp);
+        }
+        // strokes of a dragged brush overlap, so merge them into fewer uploads
+        for (auto it = dirty.begin(); it != dirty.end();) {
+            if (SDL_HasIntersection(&rect, &*it)) {
+                SDL_UnionRect(&rect, &*it, &rect);
+                it = dirty.erase(it);
+            } else {
+                ++it;
+            }
+        }
+        dirty.push_back(rect);
+    }
+    for (const auto &rect : dirty) {
+        const unsigned char *pixels = (const unsigned char *)surface->pixels + surface->pitch*rect.y + rect.x*bpp;
+        SDL_UpdateTexture(_track_tex, &rect, pixels, surface->pitch);
+    }
+    if (SDL_MUSTLOCK(surface)) SDL_UnlockSurface(surface);
+}
+
+double radius_to_correct_point(const position_t &p, const race_track_t &race_track) {
+    // sin and cos of a*M_PI for a = 0, 0.25, ..., 1.75, the directions of the search
+    static const auto directions = []() {
+        std::array<position_t, 8> d;
+        for (int i = 0; i < 8; i++) d[i] = {std::sin(i*0.25*M_PI), std::cos(i*0.25*M_PI)};
+        return d;
+    }();
+    if (race_track._collision_map(p[0],p[1]) != 255) return 0;
+    for (double r = 1.0; r < 16; r+= 1.0) {
+        for (const auto &d : directions) {
+            auto np = p;
+            np[0] += r*d[0];
+            np[1] += r*d[1];
+            if (race_track._collision_map(np[0],np[1]) != 255) return r;
+        }
+    }
+    return 1000.0;
+}
+
+double radius_to_correct_point_fixed(const position_t &p, const race_track_t &race_track) {
+    using namespace fixed;
+    static const auto directions = []() {
+        std::array<fixed_vec_t, 8> d;
+        for (int i = 0; i < 8; i++) d[i] = {sin(i*(quarter_turn/2)), cos(i*(quarter_turn/2))};
+        return d;
+    }();
+    if (race_track._collision_map(p[0],p[1]) != 255) return 0;
+    fixed_vec_t fp = fixed_vec_t::from_position(p);
+    for (int r = 1; r < 16; r++) {
+        for (const auto &d : directions) {
+            auto np = fp + d*fixed_t::from_int(r);
+            if (race_track._collision_map((int)(np.x.raw >> fixed_t::fraction_bits), (int)(np.y.raw >> fixed_t::fraction_bits)) != 255) return r;
+        }
+    }
+    return 1000.0;
+}
+
+std::vector<position_t> check_collision(const std::vector<position_t> &collision_pts, position_t p, double angle,const logic_bitmap_t &collision_map) {
+    std::vector<position_t> in_collision;
+    for (auto hp: collision_pts) {
+        auto orig_hp = hp;
+        hp = rotate_around(hp,angle) + p;
+        if (collision_map(hp[0],hp[1]) == 255)
+            //in_collision.push_back(orig_hp);
+            in_collision.push_back(hp);
+    }
+    return in_collision;
+}
+
+std::vector<position_t> check_collision_fixed(const std::vector<position_t> &collision_pts, position_t p, double angle, const logic_bitmap_t &collision_map) {
+    using namespace fixed;
+    std::vector<position_t> in_collision;
+    angle_t a = angle_from_radians(angle);
+    fixed_t c = cos(a);
+    fixed_t s = sin(a);
+    fixed_vec_t fp = fixed_vec_t::from_position(p);
+    for (const auto &pt : collision_pts) {
+        fixed_vec_t hp = fixed_vec_t::from_position(pt);
+        hp = fixed_vec_t{hp.x*c - hp.y*s, hp.x*s + hp.y*c} + fp;
+        int x = (int)(hp.x.raw >> fixed_t::fraction_bits);
+        int y = (int)(hp.y.raw >> fixed_t::fraction_bits);
+        if (collision_map(x, y) == 255)
+            in_collision.push_back(hp.to_position());
+    }
+    return in_collision;
+}
+
+void collision_cache_c::validate(const race_track_t &race_track, const std::vector<position_t> &collision_pts) {
+    if ((_track == &race_track) && (_generation == race_track.collision_generation()) &&
+        (_points == &collision_pts) && (_cells.size() == collision_pts.size())) return;
+    _track = &race_track;
+    _generation = race_track.collision_generation();
+    _points = &collision_pts;
+    _cells.assign(collision_pts.size(), {std::numeric_limits<int>::min(), std::numeric_limits<int>::min()});
+    _in_wall.assign(collision_pts.size(), 0);
+    _memo.assign((collision_pts.size() <= max_memo_points) ? memo_size : 0, repair_cost_t());
+}
+
+void collision_cache_c::footprint(const std::vector<position_t> &collision_pts, const position_t p, const double angle, const logic_bitmap_t &collision_map) {
+    // rotate_around without the pivot, with sin and cos computed once for the pose
+    const double c = std::cos(angle), s = std::sin(angle);
+    _world_pts.resize(collision_pts.size());
+    for (size_t i = 0; i < collision_pts.size(); i++) {
+        const auto &pt = collision_pts[i];
+        position_t hp = position_t{pt[0]*c - pt[1]*s, pt[0]*s + pt[1]*c} + p;
+        // the same pixel as logic_bitmap_t::operator() picks for hp
+        std::array<int, 2> cell = {(int)hp[0], (int)hp[1]};
+        if (cell != _cells[i]) {
+            _cells[i] = cell;
+            _in_wall[i] = (collision_map(cell[0], cell[1]) == 255);
+            _stats.probes++;
+        } else {
+            _stats.probes_saved++;
+        }
+        _world_pts[i] = hp;
+    }
+}
+
+std::vector<position_t> collision_cache_c::check_collision(const std::vector<position_t> &collision_pts, const position_t p, const double angle, const race_track_t &race_track) {
+    validate(race_track, collision_pts);
+    footprint(collision_pts, p, angle, race_track._collision_map);
+    std::vector<position_t> in_collision;
+    for (size_t i = 0; i < _world_pts.size(); i++)
+        if (_in_wall[i]) in_collision.push_back(_world_pts[i]);
+    return in_collision;
+}
+
+std::pair<std::vector<position_t>, double> collision_cache_c::repair_cost(const std::vector<position_t> &collision_pts, const position_t p, const double angle, const race_track_t &race_track) {
+    validate(race_track, collision_pts);
+    pose_key_t key;
+    std::memcpy(&key.x, &p[0], sizeof(double));
+    std::memcpy(&key.y, &p[1], sizeof(double));
+    std::memcpy(&key.angle, &angle, sizeof(double));
+    repair_cost_t *slot = nullptr;
+    if (_memo.size() > 0) {
+        uint64_t h = key.x * 0x9e3779b97f4a7c15ull;
+        h = (h ^ key.y) * 0xbf58476d1ce4e5b9ull;
+        h = (h ^ key.angle) * 0x94d049bb133111ebull;
+        slot = &_memo[(h >> 32) & (memo_size - 1)];
+    }
+    std::vector<position_t> in_collision;
+    if (slot && slot->valid && (slot->pose == key)) {
+        _stats.memo_hits++;
+        const double c = std::cos(angle), s = std::sin(angle);
+        for (size_t i = 0; i < collision_pts.size(); i++) {
+            if (!(slot->hits & (1ull << i))) continue;
+            const auto &pt = collision_pts[i];
+            in_collision.push_back(position_t{pt[0]*c - pt[1]*s, pt[0]*s + pt[1]*c} + p);
+        }
+        return {in_collision, slot->penalty};
+    }
+    _stats.memo_misses++;
+
+    footprint(collision_pts, p, angle, race_track._collision_map);
+    uint64_t hits = 0;
+    double penalty = 0.0;
+    for (size_t i = 0; i < _world_pts.size(); i++) {
+        if (!_in_wall[i]) continue;
+        if (i < max_memo_points) hits |= 1ull << i;
+        in_collision.push_back(_world_pts[i]);
+        penalty += (radius_to_correct_point(_world_pts[i], race_track))*2.0;
+    }
+    if (in_collision.size() > 0) penalty += 100.0;
+    if (slot) *slot = {key, true, hits, penalty};
+    return {in_collision, penalty};
+}
+
+std::vector<position_t> check_collision(const car_t &car, const race_track_t &race_track) {
+    if (race_track.collision_mode() == collision_mode_e::SAT)
+        return race_track._wall_shapes->check_collision({car.p, car.half_size, car.angle}, race_track._collision_map);
+    if (race_track.collision_mode() == collision_mode_e::FIXED)
+        return check_collision_fixed(*car.collision_pts.get(), car.p, car.angle, race_track._collision_map);
+    if (car.collision_cache)
+        return car.collision_cache->check_collision(*car.collision_pts.get(), car.p, car.angle, race_track);
+    return check_collision(*car.collision_pts.get(), car.p, car.angle, race_track._collision_map);
+}
+
+car_t place_car_on_race_track(const race_track_t &race_track, const car_t &car) {
+    car_t ct = car;
+
+    for (double x = 0; x < race_track.width(); x+= 2.0) {
+    for (double y = 0; y < race_track.height(); y+= 2.0) {
+        ct.p = {x,y};
+        std::vector<position_t> collisions = check_collision(ct, race_track);
+        if (collisions.size() == 0) return ct;
+    }
+    }
+    throw std::invalid_argument("could not place car on map due to not enough free space on the map");
+}
+
+/**
+ * @brief Distance along the ray to the first wall, at most max_distance.
+ */
+static double free_distance(const position_t &p, const double angle, const logic_bitmap_t &collision_map, const double max_distance) {
+    auto direction = rotate_around({1.0, 0.0}, angle);
+    for (double d = 0.0; d < max_distance; d += 4.0) {
+        auto q = p + direction*d;
+        if (collision_map(q[0], q[1]) == 255) return d;
+    }
+    return max_distance;
+}
+
+void input_autopilot_c::look(const car_state_t &car, const logic_bitmap_t &collision_map) {
+    const double max_distance = 200.0;
+    const double side_angle = 0.5;
+    // rays start at the front of the car
+    auto front = car.p + rotate_around({32.0, 0.0}, car.angle);
+    double ahead = free_distance(front, car.angle, collision_map, max_distance);
+    double left = free_distance(front, car.angle - side_angle, collision_map, max_distance);
+    double right = free_distance(front, car.angle + side_angle, collision_map, max_distance);
+
+    position_t a = {0.0, 1.0};
+    if ((ahead < max_distance) || (std::abs(left - right) > 40.0)) a[0] = (right > left) ? 1.0 : -1.0;
+    // back off from a wall right in front
+    if (ahead < 16.0) a = {-a[0], -1.0};
+    _state = {a};
+}
+
+repair_budget_c::repair_budget_c(const simulation_params_t &params) :
+    _evaluations_left((params.repair_budget > 0) ? params.repair_budget : std::numeric_limits<int>::max()),
+    _timed(params.repair_time_budget_us > 0),
+    _deadline(std::chrono::steady_clock::now() + std::chrono::microseconds(params.repair_time_budget_us)) {
+}
+
+bool repair_budget_c::spend() {
+    if (_exhausted) return false;
+    if ((_evaluations_left <= 0) || (_timed && (std::chrono::steady_clock::now() >= _deadline))) {
+        _exhausted = true;
+        return false;
+    }
+    _evaluations_left--;
+    _spent++;
+    return true;
+}
+
+std::ostream &operator<<(std::ostream &o, const repair_stats_t &s) {
+    o << "repairs: " << s.repairs << " fixed: " << s.fixed << " not fixed: " << s.not_fixed
+      << " overruns: " << s.overruns << " evaluations: " << s.evaluations;
+    return o;
+}
+
+namespace heuristic {
+
+/**
+ * @brief goal_collision of the fixed collision mode, all in fixed point.
+ */
+static std::pair<double,std::vector<position_t>> goal_collision_fixed(const car_t &new_car, const car_t &current_car, const race_track_t &race_track) {
+    using namespace fixed;
+    static const fixed_t radians_per_unit = fixed_t::from_double(2.0*pi);
+    auto collision_points = check_collision(new_car, race_track);
+    int64_t turn = (int32_t)(angle_from_radians(new_car.angle) - angle_from_radians(current_car.angle));
+    fixed_t diff_angle = fixed_t::from_raw(std::abs(turn)) * radians_per_unit;
+    fixed_t diff_position = length(fixed_vec_t::from_position(new_car.p) - fixed_vec_t::from_position(current_car.p));
+    int64_t sum_col = 0;
+    for (auto &p: collision_points) {
+        sum_col += (int64_t)radius_to_correct_point_fixed(p, race_track)*2;
+    }
+    if (collision_points.size() > 0) sum_col += 100;
+    fixed_t goal = diff_angle*fixed_t::from_int(4) + sqrt(diff_position + fixed_t::from_int(3)) + fixed_t::from_int(sum_col);
+    return {goal.to_double(), collision_points};
+}
+
+std::pair<double,std::vector<position_t>> goal_collision(const car_t &new_car, const car_t &current_car, const std::shared_ptr<race_track_t> race_track) {
+    if (race_track->collision_mode() == collision_mode_e::FIXED) return goal_collision_fixed(new_car, current_car, *race_track);
+    double diff_angle = std::abs(angle_between_vectors(rotate_around({1.0,0.0}, new_car.angle), rotate_around({1.0,0.0}, current_car.angle)));
+    double diff_position = ~(new_car.p - current_car.p);
+    if (new_car.collision_cache && (race_track->collision_mode() == collision_mode_e::PIXELS)) {
+        auto [collision_points, sum_col] = new_car.collision_cache->repair_cost(*new_car.collision_pts, new_car.p, new_car.angle, *race_track);
+        return {diff_angle*4.0 + std::sqrt(diff_position+3.0) + sum_col,collision_points};
+    }
+    if (race_track->collision_mode() == collision_mode_e::SAT) {
+        // the contacts lie on the wall edge, so the depth comes from the separating axes
+        std::vector<double> depths;
+        auto collision_points = race_track->_wall_shapes->check_collision({new_car.p, new_car.half_size, new_car.angle}, race_track->_collision_map, &depths);
+        double sum_col = 0.0;
+        for (auto depth : depths) sum_col += depth*2.0;
+        if (collision_points.size() > 0) sum_col += 100.0;
+        return {diff_angle*4.0 + std::sqrt(diff_position+3.0) + sum_col,collision_points};
+    }
+    auto collision_points = check_collision(new_car, *race_track);
+    double sum_col = 0.0;
+    for (auto &p: collision_points) {
+        sum_col += (radius_to_correct_point(p,*race_track))*2.0;
+    }
+    if (collision_points.size() > 0) sum_col += 100.0;
+    return {diff_angle*4.0 + std::sqrt(diff_position+3.0) + sum_col,collision_points};
+
+}
+
+std::vector<car_t> generate_neighbors(car_t c, const simulation_params_t &params) {
+    const double d = params.repair_position_step;
+    const double diagonal = d*0.6;
+    std::vector<car_t> ret;
+    car_t tmp = c;
+    tmp.angle += params.repair_angle_step;
+    ret.push_back(tmp);
+    tmp = c;
+    tmp.angle -= params.repair_angle_step;
+    ret.push_back(tmp);
+    tmp = c;
+    tmp.p[0] -= d;
+    ret.push_back(tmp);
+    tmp = c;
+    tmp.p[0] += d;
+    ret.push_back(tmp);
+    tmp = c;
+    tmp.p[1] -= d;
+    ret.push_back(tmp);
+    tmp = c;
+    tmp.p[1] += d;
+    ret.push_back(tmp);
+
+    tmp = c;
+    tmp.p[0] -= diagonal;
+    tmp.p[1] -= diagonal;
+    ret.push_back(tmp);
+
+    tmp = c;
+    tmp.p[0] += diagonal;
+    tmp.p[1] -= diagonal;
+    ret.push_back(tmp);
+
+    tmp = c;
+    tmp.p[0] += diagonal;
+    tmp.p[1] += diagonal;
+    ret.push_back(tmp);
+
+    tmp = c;
+    tmp.p[0] += diagonal;
+    tmp.p[1] -= diagonal;
+    ret.push_back(tmp);
+
+    return ret;
+}
+
+std::pair<car_t,std::vector<position_t>> find_best_corrected_position(car_t car_to_fix, const std::shared_ptr<race_track_t> race_track, const simulation_params_t &params, repair_budget_c *budget) {
+    auto best_car = car_to_fix;
+    auto [best_goal, collision_points] = goal_collision(best_car, car_to_fix, race_track);
+
+    for (int i = 0; i < params.repair_iterations; i++) {
+            auto neighbors = generate_neighbors(best_car, params);
+            bool no_better = true;
+            for (auto &c_car : neighbors)             {
+                if (budget && !budget->spend()) return {best_car, collision_points};
+                auto [c_goal, c_collision_points] = goal_collision(c_car, car_to_fix, race_track);
+                if (c_goal < best_goal) {
+                    best_goal = c_goal;
+                    best_car = c_car;
+                    collision_points = c_collision_points;
+                    no_better = false;
+                }
+            }
+            if (no_better) {
+                std::cerr << "no better " << i << std::endl;
+                break;
+            }
+    }
+    return {best_car, collision_points};
+}
+}
+
+/**
+ * @brief The cheap way out of a collision: back to the last pose, which was
+ * free, without the part of the velocity that goes into the wall. The wall
+ * normal points to the centroid of the wall pixels around the contacts.
+ * With fixed_math the velocity is projected in fixed point.
+ */
+static car_t revert_to_last_pose(const car_t &car, const car_t &new_car, const std::vector<position_t> &contacts, const logic_bitmap_t &collision_map, const bool fixed_math) {
+    const int r = 4;
+    car_t ret = car;
+    ret.v = new_car.v;
+    int towards_wall_x = 0, towards_wall_y = 0;
+    for (const auto &p : contacts) {
+        int cx = p[0], cy = p[1];
+        for (int dy = -r; dy <= r; dy++)
+            for (int dx = -r; dx <= r; dx++)
+                if ((dx*dx + dy*dy <= r*r) && (collision_map(cx + dx, cy + dy) == 255)) {
+                    towards_wall_x += dx;
+                    towards_wall_y += dy;
+                }
+    }
+    if (fixed_math) {
+        using namespace fixed;
+        fixed_vec_t towards_wall = {fixed_t::from_int(towards_wall_x), fixed_t::from_int(towards_wall_y)};
+        fixed_t length_squared = towards_wall.x*towards_wall.x + towards_wall.y*towards_wall.y;
+        if (length_squared.raw == 0) {
+            ret.v = {0.0, 0.0};
+            return ret;
+        }
+        fixed_vec_t v = fixed_vec_t::from_position(ret.v);
+        fixed_t into_wall = v.x*towards_wall.x + v.y*towards_wall.y;
+        if (into_wall.raw > 0) ret.v = (v - towards_wall*(into_wall/length_squared)).to_position();
+        return ret;
+    }
+    position_t towards_wall = {(double)towards_wall_x, (double)towards_wall_y};
+    double length = ~towards_wall;
+    if (length < 0.0001) {
+        ret.v = {0.0, 0.0};
+        return ret;
+    }
+    auto normal = towards_wall*(1.0/length);
+    double into_wall = ret.v[0]*normal[0] + ret.v[1]*normal[1];
+    if (into_wall > 0.0) ret.v = ret.v - normal*into_wall;
+    return ret;
+}
+
+/**
+ * @brief Velocity of a car the search moved to fixed_car, in fixed point.
+ *
+ * The car already stands on the repaired pose, so like in the double version
+ * the speed turns along the car axis, to the side closer to the old velocity.
+ */
+static position_t repaired_velocity_fixed(const car_t &fixed_car) {
+    using namespace fixed;
+    fixed_vec_t v = fixed_vec_t::from_position(fixed_car.v) * fixed_t::from_double(0.98);
+    fixed_t velocity = length(v);
+    if (velocity <= fixed_t::from_double(0.0001)) return v.to_position();
+    angle_t a = angle_from_radians(fixed_car.angle);
+    fixed_vec_t nv1 = {cos(a)*velocity, sin(a)*velocity};
+    fixed_vec_t nv2 = {-nv1.x, -nv1.y};
+    return ((length(nv1 - v) < length(nv2 - v)) ? nv1 : nv2).to_position();
+}
+
+std::vector<car_t> simulation_step(const std::vector<car_t> &cars, const std::shared_ptr<race_track_t> race_track, const double dt, std::vector<position_t> &collisions_draw, const simulation_params_t &params, repair_stats_t *stats) {
+        repair_stats_t tick_stats;
+        const int substeps = std::max(1, params.substeps);
+        const double h = dt/substeps;
+        const double drag = std::max(0.0, 1.0 - params.extra_friction*h);
+        std::vector<car_t> new_cars;
+        for (auto &car:cars) {
+            car_t new_car = car;
+            for (int s = 0; s < substeps; s++) {
+                new_car = new_car.update(h);
+                if (params.extra_friction != 0.0) new_car.v = new_car.v*drag;
+            }
+            new_cars.push_back(new_car);
+        }
+
+        for (int i = 0; i < cars.size(); i++) {
+            auto car = cars[i];
+            auto new_car = new_cars[i];
+            std::vector<position_t> collisions = check_collision(new_car, *race_track);
+            if (collisions.size() > 0) {
+                collisions_draw = collisions;
+                const auto contacts = collisions;
+
+                tick_stats.repairs++;
+                repair_budget_c budget(params);
+                auto [nncar, collisions] = heuristic::find_best_corrected_position(new_car, race_track, params, &budget);
+                tick_stats.evaluations += budget.spent();
+                if ((collisions.size() > 0) && budget.exhausted()) {
+                    tick_stats.overruns++;
+                    car = revert_to_last_pose(car, new_car, contacts, race_track->_collision_map, race_track->collision_mode() == collision_mode_e::FIXED);
+                } else if (collisions.size() == 0) {
+                    tick_stats.fixed++;
+                    std::cerr << "fixed: " << car.p << " " << car.angle << " to " << nncar.p << " " << nncar.angle << std::endl;
+                    car = nncar; // this is the correct car position
+                    if (race_track->collision_mode() == collision_mode_e::FIXED) {
+                        car.v = repaired_velocity_fixed(car);
+                    } else {
+                        car.v = car.v * 0.98;
+                        auto velocity = ~car.v;
+                        if (velocity > 0.0001) {
+                            auto intended_move_vector = new_car.p - car.p;
+                            auto actual_move_vector = nncar.p - car.p;
+                            auto fix_vector = actual_move_vector - intended_move_vector;
+                            if ((~fix_vector > 0.001) && (~actual_move_vector > 0.001)) {
+                                intended_move_vector = intended_move_vector *(1.0/~intended_move_vector);
+                                actual_move_vector = actual_move_vector *(1.0/~actual_move_vector);
+                                auto move_vector_mirrored = actual_move_vector + fix_vector;
+                                car.v = (move_vector_mirrored * 1.0/~move_vector_mirrored) * velocity;
+                            } else {
+                                auto nv1 = rotate_around({1.0,0.0},car.angle)*~car.v;
+                                auto nv2 = nv1*-1.0;
+                                car.v = (~(nv1-car.v) < ~(nv2-car.v))?nv1:nv2;
+                            }
+                        }
+                    }
+                } else {
+                    tick_stats.not_fixed++;
+                    std::cerr << "not fixed: " << car.p << " " << car.angle << " to " << nncar.p << " " << nncar.angle << "   c: " << collisions.size() <<  std::endl;
+                    car.v = {0.0, 0.0};
+                }
+            } else {
+                car = new_car;
+            }
+
+            new_cars[i] = car;
+        }
+        if (stats) {
+            stats->repairs += tick_stats.repairs;
+            stats->fixed += tick_stats.fixed;
+            stats->not_fixed += tick_stats.not_fixed;
+            stats->overruns += tick_stats.overruns;
+            stats->evaluations += tick_stats.evaluations;
+        }
+        return new_cars;
+}
+
+}
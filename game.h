@@ -0,0 +1,561 @@
+/*
+
+MIT License with AI exception
+
+Copyright (c) Tadeusz Puźniakowski 2024
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is furnished
+to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+Additional restriction:
+
+The Software may not be used, in whole or in part, to teach or train any
+artificial intelligence system, including but not limited to large language
+models (LLMs), neural networks, or any other type of AI technology. Violation of
+this restriction will be considered a breach of this License.
+
+*/
+
+
+
+#ifndef MCGGAME_GAME_H
+#define MCGGAME_GAME_H
+
+#include "engine.h"
+#include "collision_shapes.h"
+#include "physics.h"
+#include "graphics.h"
+
+#include <memory>
+#include <vector>
+#include <string>
+#include <functional>
+#include <cmath>
+#include <mutex>
+#include <stdexcept>
+#include <cstdint>
+#include <chrono>
+#include <ostream>
+#include <array>
+
+namespace mcggame {
+
+/**
+ * @brief Loads a BMP into a texture. With no renderer only the callback gets
+ * the pixels and the result is nullptr.
+ */
+std::shared_ptr<SDL_Texture> load_texture(SDL_Renderer *_renderer, const std::string fname, std::function<void(SDL_Surface *)> callback = [](SDL_Surface *){});
+
+/**
+ * @brief Reads a BMP and sets the transparent color. Can run on any thread.
+ */
+std::shared_ptr<SDL_Surface> decode_bmp(const std::string fname);
+
+/**
+ * @brief Texture from decoded pixels. Only on the thread of the renderer.
+ */
+std::shared_ptr<SDL_Texture> upload_texture(SDL_Renderer *_renderer, SDL_Surface *surface);
+
+/**
+ * @brief Everything about a race track that can be prepared without the
+ * renderer, so it can be decoded on a worker thread.
+ */
+struct track_asset_t {
+    std::shared_ptr<SDL_Surface> surface;        ///< ARGB8888, the road is transparent
+    logic_bitmap_t collision_map;
+    std::shared_ptr<wall_shapes_c> wall_shapes;  ///< only when the walls were vectorized
+
+    static track_asset_t decode(const std::string fname, const bool vectorize_walls = false);
+};
+
+/**
+ * @brief Decoded sprite, waiting to be uploaded on the render thread.
+ */
+struct sprite_asset_t {
+    std::shared_ptr<SDL_Surface> surface;
+};
+
+/**
+ * @brief Round brush that paints or erases walls on the race track.
+ */
+struct track_edit_t {
+    position_t center;
+    double radius;
+    bool wall; ///< true paints a wall, false erases it to the road
+};
+
+class race_track_t {
+    SDL_Texture *_track_tex;
+    std::shared_ptr<SDL_Texture> _track_tex_p;
+    SDL_Renderer *_renderer;
+    
+    collision_mode_e _collision_mode = collision_mode_e::PIXELS;
+
+    std::shared_ptr<SDL_Surface> _track_surface; ///< copy of the texture pixels, owned by the render thread
+    uint64_t _collision_generation = 0;
+
+    std::mutex _edits_mutex;
+    std::vector<track_edit_t> _requested_edits; ///< waiting for the simulation thread
+    std::vector<track_edit_t> _applied_edits;   ///< waiting for the render thread
+    
+public:
+
+    logic_bitmap_t _collision_map;
+    std::shared_ptr<wall_shapes_c> _wall_shapes; ///< vectorized walls, only in the SAT collision mode
+
+    static position_t to_screen_coordinates(const position_t p, const position_t cam, double scale = 1.0) {
+        auto p2 = (p - cam)*scale;
+        return p2 + position_t{game_view_width*0.5, game_view_height*0.5};
+    }
+
+    static position_t from_screen_coordinates(const position_t p, const position_t cam, double scale = 1.0) {
+        auto p2 = p - position_t{game_view_width*0.5, game_view_height*0.5};
+        return p2*(1.0/scale) + cam;
+    }
+
+    void draw(double cam_x, double cam_y, double scale = 1.0) const {
+            draw(view_t{{0, 0, game_view_width, game_view_height}, {cam_x, cam_y}, scale});
+    }
+
+    /**
+     * @brief Draws only the part of the track visible in the view.
+     */
+    void draw(const view_t &view) const {
+            SDL_Rect source_rect = view.visible_pixels(width(), height());
+            if ((source_rect.w == 0) || (source_rect.h == 0)) return;
+
+            auto p1 = view.to_screen({(double)source_rect.x, (double)source_rect.y});
+            auto p2 = view.to_screen({(double)(source_rect.x + source_rect.w), (double)(source_rect.y + source_rect.h)});
+            SDL_Rect destination_rect = {(int)std::floor(p1[0]),
+                                        (int)std::floor(p1[1]),
+                                        (int)std::floor(p2[0]) - (int)std::floor(p1[0]),
+                                        (int)std::floor(p2[1]) - (int)std::floor(p1[1])};
+
+            SDL_RenderCopyEx(_renderer, _track_tex, &source_rect, &destination_rect,
+                                        0, nullptr, SDL_FLIP_NONE);
+    }
+
+    int width() const {return _collision_map.w; }
+    int height() const {return _collision_map.h; }    
+
+    collision_mode_e collision_mode() const {return _collision_mode; }
+
+    /**
+     * @brief Selects how cars collide with the track. The walls are
+     * vectorized the first time the SAT mode is selected.
+     */
+    void set_collision_mode(const collision_mode_e mode) {
+        if ((mode == collision_mode_e::SAT) && !_wall_shapes)
+            _wall_shapes = std::make_shared<wall_shapes_c>(_collision_map);
+        _collision_mode = mode;
+    }
+
+    race_track_t(const std::string fname, SDL_Renderer *renderer) : race_track_t(track_asset_t::decode(fname), renderer) {
+    }
+
+    /**
+     * @brief Track from an asset decoded before, only uploads the texture.
+     */
+    race_track_t(const track_asset_t &asset, SDL_Renderer *renderer);
+
+    /**
+     * @brief Queues an edit of the track. Can be called from any thread, the
+     * edit takes effect in apply_edit_requests().
+     */
+    void request_edit(const track_edit_t &edit);
+
+    /**
+     * @brief Applies the queued edits to the collision map and to the
+     * vectorized walls. Called by the simulation thread between ticks.
+     *
+     * @return true if the collision map changed
+     */
+    bool apply_edit_requests();
+
+    /**
+     * @brief Paints the brush into the collision map and rebuilds the wall
+     * tiles it touched. The texture is updated later by upload_dirty_regions().
+     */
+    void apply_edit(const track_edit_t &edit);
+
+    /**
+     * @brief Repaints the applied edits into the track texture, uploading only
+     * the dirty rectangles. Called by the render thread.
+     */
+    void upload_dirty_regions();
+
+    /**
+     * @brief Increases every time the collision map changes.
+     */
+    uint64_t collision_generation() const {return _collision_generation; }
+
+    virtual ~race_track_t() {
+    }
+};
+using p_race_track = std::shared_ptr<race_track_t>;
+
+
+class input_i {
+public:
+    virtual input_state_t get_state() const = 0;
+};
+
+/**
+ * @brief Distance from the point in a wall to the nearest free pixel, looking
+ * in 8 directions up to 15 pixels. 0 when the point is free.
+ */
+double radius_to_correct_point(const position_t &p, const race_track_t &race_track);
+
+/**
+ * @brief radius_to_correct_point with the search directions and steps in
+ * fixed point, for the fixed collision mode.
+ */
+double radius_to_correct_point_fixed(const position_t &p, const race_track_t &race_track);
+
+std::vector<position_t> check_collision(const std::vector<position_t> &collision_pts, position_t p, double angle,const logic_bitmap_t &collision_map);
+
+/**
+ * @brief check_collision with the points rotated in fixed point, so the
+ * same pose hits the same pixels on every machine.
+ */
+std::vector<position_t> check_collision_fixed(const std::vector<position_t> &collision_pts, position_t p, double angle, const logic_bitmap_t &collision_map);
+
+/**
+ * @brief Collision results of one car, reused between ticks and between the
+ * candidate poses of the repair. Only the PIXELS collision mode uses it.
+ *
+ * The last footprint keeps the pixel of every collision point and whether
+ * it is a wall, so a new pose probes the bitmap only for the points that
+ * moved to another pixel. The repair costs are memoized by the exact bits of
+ * the pose in a direct mapped table, so a hit is always the same pose: the
+ * hill climb visits again the candidates of the previous step, e.g. the
+ * turn back after a turn. Everything is dropped when the collision map
+ * changes or another track is used.
+ */
+class collision_cache_c {
+public:
+    struct stats_t {
+        uint64_t probes = 0;        ///< bitmap reads
+        uint64_t probes_saved = 0;  ///< points that stayed in their pixel
+        uint64_t memo_hits = 0;
+        uint64_t memo_misses = 0;
+    };
+
+private:
+    struct pose_key_t {
+        uint64_t x, y, angle;   ///< bit patterns of the doubles
+        bool operator==(const pose_key_t &o) const { return (x == o.x) && (y == o.y) && (angle == o.angle); }
+    };
+    struct repair_cost_t {
+        pose_key_t pose;
+        bool valid = false;
+        uint64_t hits;              ///< bit i is set when collision point i is in a wall
+        double penalty;
+    };
+    static const size_t memo_size = 256;   ///< power of two
+    static const size_t max_memo_points = 64;
+
+    const race_track_t *_track = nullptr;
+    uint64_t _generation = 0;
+    const std::vector<position_t> *_points = nullptr;
+    std::vector<std::array<int, 2>> _cells;
+    std::vector<uint8_t> _in_wall;
+    std::vector<position_t> _world_pts;
+    std::vector<repair_cost_t> _memo;
+    stats_t _stats;
+
+    void validate(const race_track_t &race_track, const std::vector<position_t> &collision_pts);
+    void footprint(const std::vector<position_t> &collision_pts, const position_t p, const double angle, const logic_bitmap_t &collision_map);
+
+public:
+    /**
+     * @brief Same result as check_collision on the collision map of the track.
+     */
+    std::vector<position_t> check_collision(const std::vector<position_t> &collision_pts, const position_t p, const double angle, const race_track_t &race_track);
+
+    /**
+     * @brief The collision points of the pose and the penalty of the repair
+     * goal for them, see heuristic::goal_collision.
+     */
+    std::pair<std::vector<position_t>, double> repair_cost(const std::vector<position_t> &collision_pts, const position_t p, const double angle, const race_track_t &race_track);
+
+    const stats_t &stats() const { return _stats; }
+};
+
+class car_t {
+    SDL_Renderer * _renderer;
+    public:
+        std::shared_ptr<std::vector<position_t>> wheels;
+        position_t p;
+        position_t v;
+        position_t a;
+        double angle;
+        position_t half_size; ///< half of the car box, for the SAT collision mode
+
+        car_physics_fn physics;
+
+        std::shared_ptr<SDL_Texture> texture;
+        std::shared_ptr<rotated_sprite_cache_c> rotated_sprites; ///< pre-rotated texture, when enabled
+
+        std::shared_ptr<input_i> input;
+
+        std::shared_ptr<std::vector<position_t>> collision_pts;
+        std::shared_ptr<collision_cache_c> collision_cache; ///< give every car its own, the cache is not thread safe
+
+    static car_t create( SDL_Renderer * renderer, 
+            std::shared_ptr<input_i> input_,
+            const position_t p_ = {0.0,0.0},
+            const position_t v_ = {0.0,0.0},
+            const position_t a_ = {0.0,0.0},
+            const std::string car_texture_name = "assets/car_01.bmp",
+            const car_physics_fn physics_ = &arcade_physics::step,
+            const int sprite_cache_frames = 0) 
+    {
+        car_t ret;
+        
+        ret.input = input_;
+        ret._renderer = renderer;
+        if (renderer) ret.set_sprite(renderer, sprite_asset_t{decode_bmp(car_texture_name)}, sprite_cache_frames);
+        ret.p = p_;
+        ret.v = v_;
+        ret.a = a_;
+        ret.angle = 0.0;
+        ret.physics = physics_;
+        ret.wheels = std::make_shared<std::vector<position_t>>();
+        ret.wheels->push_back({30.0,0.0});
+        ret.wheels->push_back({-30.0,0.0});
+
+        std::vector<position_t> cp;
+        for (double x = -32; x <= 32; x+= 8.0)
+        for (double y = -16; y <= 16; y+= 8.0) {
+            cp.push_back({x,y});
+        }
+        ret.collision_pts = std::make_shared<std::vector<position_t>>(cp);
+        ret.collision_cache = std::make_shared<collision_cache_c>();
+        ret.half_size = {32.0, 16.0};
+
+        return ret;
+    }
+
+    
+    
+    /**
+     * @brief Uploads the texture of the car. Only on the render thread.
+     */
+    void set_sprite(SDL_Renderer *renderer, const sprite_asset_t &sprite, const int sprite_cache_frames = 0) {
+        _renderer = renderer;
+        texture = upload_texture(renderer, sprite.surface.get());
+        rotated_sprites = nullptr;
+        if (sprite_cache_frames > 0) rotated_sprites = std::make_shared<rotated_sprite_cache_c>(renderer, sprite.surface.get(), sprite_cache_frames);
+    }
+
+    car_t update(double dt) const {
+        car_t ret = *this;
+        ret.set_state(physics(state(), input->get_state(), dt));
+        return ret;
+    }
+
+    car_state_t state() const {
+        return {p, v, a, angle};
+    }
+
+    void set_state(const car_state_t &s) {
+        p = s.p;
+        v = s.v;
+        a = s.a;
+        angle = s.angle;
+    }
+
+    void draw(position_t cam, double scale = 1.0) const {
+        draw(state(), cam, scale);
+    }
+
+    /**
+     * @brief Draws this car's texture at the pose given in state, so the
+     * render thread can draw snapshots without owning the simulated car.
+     */
+    void draw(const car_state_t &state, position_t cam, double scale = 1.0) const {
+        draw(state, view_t{{0, 0, game_view_width, game_view_height}, cam, scale});
+    }
+
+    void draw(const car_state_t &state, const view_t &view) const {
+
+
+        auto p1 = view.to_screen(state.p - position_t{32.0, 32.0});
+        auto p2 = view.to_screen(state.p + position_t{32.0, 32.0});
+        auto dp = p2-p1;
+            if (rotated_sprites) {
+                rotated_sprites->draw(_renderer, view.to_screen(state.p), dp, state.angle);
+                return;
+            }
+            SDL_Rect destination_rect = {(int)p1[0],
+                                         (int)p1[1],
+                                         (int)dp[0],
+                                         (int)dp[1]};
+
+            SDL_RenderCopyEx(_renderer, texture.get(), nullptr, &destination_rect,
+                                        (state.angle/M_PI)*180.0, nullptr, SDL_FLIP_NONE);
+    }
+
+    /**
+     * @brief Radius of a circle around the car that contains its texture.
+     */
+    static double draw_radius() {
+        return 32.0*M_SQRT2;
+    }
+};
+
+/**
+ * @brief Collision points of the car with the race track, in the collision mode of the track.
+ */
+std::vector<position_t> check_collision(const car_t &car, const race_track_t &race_track);
+
+car_t place_car_on_race_track(const race_track_t &race_track, const car_t &car);
+
+
+class input_keyboard_c : public input_i {
+public:
+    input_state_t get_state() const {
+        auto keyboard_state = SDL_GetKeyboardState(nullptr);
+        position_t a = {0.0,0.0};
+        if (keyboard_state[SDL_SCANCODE_RIGHT]) a[0] += 1;
+        if (keyboard_state[SDL_SCANCODE_LEFT]) a[0] -= 1;
+        if (keyboard_state[SDL_SCANCODE_UP]) a[1] += 1;
+        if (keyboard_state[SDL_SCANCODE_DOWN]) a[1] -= 1;
+        return {a};
+    };
+};
+
+class input_joystick_c : public input_i {
+public:
+    input_state_t get_state() const {
+        auto keyboard_state = SDL_GetKeyboardState(nullptr);
+        position_t a = {0.0,0.0};
+        if (keyboard_state[SDL_SCANCODE_D]) a[0] += 1;
+        if (keyboard_state[SDL_SCANCODE_A]) a[0] -= 1;
+        if (keyboard_state[SDL_SCANCODE_W]) a[1] += 1;
+        if (keyboard_state[SDL_SCANCODE_S]) a[1] -= 1;
+        return {a};
+    };
+};
+
+/**
+ * @brief Drives by itself, for exports and replays without players. It
+ * looks along three rays ahead of the car and turns to the freer side.
+ */
+class input_autopilot_c : public input_i {
+    input_state_t _state = {{0.0, 0.0}};
+public:
+    /**
+     * @brief Decides the input from the current pose. Call before every simulation step.
+     */
+    void look(const car_state_t &car, const logic_bitmap_t &collision_map);
+
+    input_state_t get_state() const {
+        return _state;
+    }
+};
+
+/**
+ * @brief Simulation parameters that can change while the game runs, see
+ * config_watcher_c. The defaults are the values the game was tuned with.
+ */
+struct simulation_params_t {
+    int substeps = 1;               ///< physics steps per tick, each dt/substeps long
+    double extra_friction = 0.0;    ///< linear drag on top of the physics model, in 1/s
+    int repair_iterations = 200;    ///< hill climbing steps of heuristic::find_best_corrected_position
+    double repair_position_step = 1.0; ///< how far the neighbors are moved, in pixels
+    double repair_angle_step = 0.04;   ///< how far the neighbors are turned, in radians
+    int repair_budget = 2000;       ///< collision evaluations of the repair per car and tick, 0 is unlimited
+    int repair_time_budget_us = 0;  ///< time of the repair per car and tick, 0 is unlimited; results then depend on the machine
+};
+
+/**
+ * @brief What the collision repair of one car may still spend in the current tick.
+ *
+ * Every car gets its own budget, so the repair of a car does not depend on
+ * the other cars or their order, and a client predicting only its own car
+ * repairs it like the server. The work budget keeps the simulation
+ * deterministic, so it is the one to use with the network and the fixed
+ * point physics. The time budget bounds the tick on slow machines at the
+ * cost of that.
+ */
+class repair_budget_c {
+    int _evaluations_left;
+    bool _timed;
+    std::chrono::steady_clock::time_point _deadline;
+    bool _exhausted = false;
+    int _spent = 0;
+public:
+    repair_budget_c(const simulation_params_t &params);
+
+    /**
+     * @brief Takes one collision evaluation from the budget.
+     *
+     * @return false when the budget has run out
+     */
+    bool spend();
+    bool exhausted() const { return _exhausted; }
+    int spent() const { return _spent; }
+};
+
+/**
+ * @brief Counters of the collision repair, summed over the ticks.
+ */
+struct repair_stats_t {
+    uint64_t repairs = 0;       ///< cars that ended a step in collision
+    uint64_t fixed = 0;         ///< repaired by the search
+    uint64_t not_fixed = 0;     ///< the search gave up, the car stopped where it was
+    uint64_t overruns = 0;      ///< the budget ran out, the car went back to its last pose
+    uint64_t evaluations = 0;   ///< collision evaluations of the search
+};
+
+std::ostream &operator<<(std::ostream &o, const repair_stats_t &s);
+
+namespace heuristic {
+
+std::pair<double,std::vector<position_t>> goal_collision(const car_t &new_car, const car_t &current_car, const std::shared_ptr<race_track_t> race_track);
+
+std::vector<car_t> generate_neighbors(car_t c, const simulation_params_t &params = {});
+
+/**
+ * @brief Hill climbing from the pose in collision to the nearest free pose.
+ *
+ * Every neighbor costs one evaluation of the budget. When it runs out the
+ * best pose so far is returned, still in collision.
+ */
+std::pair<car_t,std::vector<position_t>> find_best_corrected_position(car_t car_to_fix, const std::shared_ptr<race_track_t> race_track, const simulation_params_t &params = {}, repair_budget_c *budget = nullptr);
+}
+
+/**
+ * @brief Advances all cars by one tick of dt and repairs the ones that
+ * ended up in collision with the race track.
+ *
+ * @param cars cars in the current tick
+ * @param race_track the race track with the collision map
+ * @param dt time step in seconds
+ * @param collisions_draw receives the collision points of the last repaired car (for debugging)
+ * @param params substeps, drag and the limits of the repair
+ * @param stats when given, the repair counters are added to it
+ * @return std::vector<car_t> cars in the next tick
+ */
+std::vector<car_t> simulation_step(const std::vector<car_t> &cars, const std::shared_ptr<race_track_t> race_track, const double dt, std::vector<position_t> &collisions_draw, const simulation_params_t &params = {}, repair_stats_t *stats = nullptr);
+
+}
+
+#endif
@@ -35,9 +35,142 @@ this restriction will be considered a breach of this License.
 
 #include "graphics.h"
 
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <stdexcept>
+
 namespace mcggame {
 
+SDL_Rect view_t::visible_pixels(const int w, const int h) const {
+    double half_w = viewport.w*0.5/scale;
+    double half_h = viewport.h*0.5/scale;
+    int x0 = std::max(0, (int)std::floor(camera[0] - half_w));
+    int y0 = std::max(0, (int)std::floor(camera[1] - half_h));
+    int x1 = std::min(w, (int)std::ceil(camera[0] + half_w) + 1);
+    int y1 = std::min(h, (int)std::ceil(camera[1] + half_h) + 1);
+    return {x0, y0, std::max(0, x1 - x0), std::max(0, y1 - y0)};
+}
+
+std::vector<SDL_Rect> split_screen(const int n, const int width, const int height) {
+    std::vector<SDL_Rect> ret;
+    if (n <= 0) return ret;
+    int rows = (int)std::ceil(std::sqrt((double)n));
+    int cols = (n + rows - 1) / rows;
+    rows = (n + cols - 1) / cols;
+    for (int i = 0; i < n; i++) {
+        int row = i / cols;
+        int col = i % cols;
+        // the last row can have fewer views, they share its width
+        int cols_in_row = (row == rows - 1) ? (n - row*cols) : cols;
+        int x0 = col*width/cols_in_row;
+        int x1 = (col + 1)*width/cols_in_row;
+        int y0 = row*height/rows;
+        int y1 = (row + 1)*height/rows;
+        ret.push_back({x0, y0, x1 - x0, y1 - y0});
+    }
+    return ret;
+}
+
+void draw_progress_bar(SDL_Renderer *renderer, const double fraction) {
+    SDL_Rect frame = {game_view_width/4, game_view_height/2 - 8, game_view_width/2, 16};
+    SDL_Rect bar = {frame.x + 2, frame.y + 2, (int)((frame.w - 4)*std::max(0.0, std::min(1.0, fraction))), frame.h - 4};
+    SDL_SetRenderDrawColor(renderer, 0xff, 0xff, 0xff, 0xff);
+    SDL_RenderDrawRect(renderer, &frame);
+    SDL_RenderFillRect(renderer, &bar);
+}
+
+/**
+ * @brief ARGB8888 pixel, or transparent black outside of the surface.
+ */
+static uint32_t argb_pixel(const SDL_Surface *surface, const int x, const int y) {
+    if ((x < 0) || (y < 0) || (x >= surface->w) || (y >= surface->h)) return 0;
+    return ((const uint32_t *)((const uint8_t *)surface->pixels + y*surface->pitch))[x];
+}
+
+void rotate_surface(SDL_Surface *source, SDL_Surface *target, const SDL_Rect &target_rect, const double angle) {
+    if (SDL_MUSTLOCK(source)) SDL_LockSurface(source);
+    if (SDL_MUSTLOCK(target)) SDL_LockSurface(target);
+    position_t source_center = {source->w*0.5, source->h*0.5};
+    position_t target_center = {target_rect.x + target_rect.w*0.5, target_rect.y + target_rect.h*0.5};
+    for (int y = target_rect.y; y < target_rect.y + target_rect.h; y++) {
+        uint32_t *row = (uint32_t *)((uint8_t *)target->pixels + y*target->pitch);
+        for (int x = target_rect.x; x < target_rect.x + target_rect.w; x++) {
+            // pixel centers are at +0.5
+            auto sp = rotate_around(position_t{x + 0.5, y + 0.5} - target_center, -angle) + source_center - position_t{0.5, 0.5};
+            int x0 = (int)std::floor(sp[0]);
+            int y0 = (int)std::floor(sp[1]);
+            double fx = sp[0] - x0;
+            double fy = sp[1] - y0;
+            uint32_t corners[4] = {argb_pixel(source, x0, y0), argb_pixel(source, x0 + 1, y0),
+                                   argb_pixel(source, x0, y0 + 1), argb_pixel(source, x0 + 1, y0 + 1)};
+            double weights[4] = {(1.0 - fx)*(1.0 - fy), fx*(1.0 - fy), (1.0 - fx)*fy, fx*fy};
+            // colors are averaged premultiplied by alpha, so transparent pixels do not bleed into the edges
+            double a = 0.0, r = 0.0, g = 0.0, b = 0.0;
+            for (int i = 0; i < 4; i++) {
+                double w = weights[i]*((corners[i] >> 24) & 0xff);
+                a += w;
+                r += w*((corners[i] >> 16) & 0xff);
+                g += w*((corners[i] >> 8) & 0xff);
+                b += w*(corners[i] & 0xff);
+            }
+            if (a < 0.5) {
+                row[x] = 0;
+                continue;
+            }
+            row[x] = ((uint32_t)std::lround(a) << 24) | ((uint32_t)std::lround(r/a) << 16) |
+                     ((uint32_t)std::lround(g/a) << 8) | (uint32_t)std::lround(b/a);
+        }
+    }
+    if (SDL_MUSTLOCK(target)) SDL_UnlockSurface(target);
+    if (SDL_MUSTLOCK(source)) SDL_UnlockSurface(source);
+}
 
+rotated_sprite_cache_c::rotated_sprite_cache_c(SDL_Renderer *renderer, SDL_Surface *sprite, const int frames) {
+    if (frames <= 0) throw std::invalid_argument("the sprite cache needs at least one frame");
+    _frames = frames;
+    _sprite_w = sprite->w;
+    _sprite_h = sprite->h;
+    // the diagonal, and a pixel of margin for the filter on both sides
+    _frame_size = (int)std::ceil(std::sqrt((double)_sprite_w*_sprite_w + (double)_sprite_h*_sprite_h)) + 2;
+    // the same parity as the sprite, so the unrotated frame is not shifted by half a pixel
+    if ((_frame_size - _sprite_w) % 2) _frame_size++;
+    _columns = (int)std::ceil(std::sqrt((double)frames));
+    int rows = (frames + _columns - 1) / _columns;
+
+    // converting to a format with alpha turns the color key into transparency
+    std::shared_ptr<SDL_Surface> source(SDL_ConvertSurfaceFormat(sprite, SDL_PIXELFORMAT_ARGB8888, 0), [](auto p){SDL_FreeSurface(p);});
+    std::shared_ptr<SDL_Surface> atlas(SDL_CreateRGBSurfaceWithFormat(0, _columns*_frame_size, rows*_frame_size, 32, SDL_PIXELFORMAT_ARGB8888), [](auto p){SDL_FreeSurface(p);});
+    if (!source || !atlas) throw std::runtime_error(SDL_GetError());
+    SDL_FillRect(atlas.get(), nullptr, 0);
+    for (int i = 0; i < frames; i++)
+        rotate_surface(source.get(), atlas.get(), frame_rect(i), i*2.0*M_PI/frames);
+
+    if (!renderer) return;
+    auto texture = SDL_CreateTextureFromSurface(renderer, atlas.get());
+    if (!texture) throw std::runtime_error(SDL_GetError());
+    SDL_SetTextureBlendMode(texture, SDL_BLENDMODE_BLEND);
+    _atlas = std::shared_ptr<SDL_Texture>(texture, [](auto p){SDL_DestroyTexture(p);});
+}
+
+int rotated_sprite_cache_c::frame_index(const double angle) const {
+    long frame = std::lround(angle*_frames/(2.0*M_PI)) % _frames;
+    return (frame < 0) ? frame + _frames : frame;
+}
+
+SDL_Rect rotated_sprite_cache_c::frame_rect(const int frame) const {
+    return {(frame % _columns)*_frame_size, (frame / _columns)*_frame_size, _frame_size, _frame_size};
+}
+
+void rotated_sprite_cache_c::draw(SDL_Renderer *renderer, const position_t &center, const position_t &size, const double angle) const {
+    SDL_Rect source_rect = frame_rect(frame_index(angle));
+    double w = _frame_size*size[0]/_sprite_w;
+    double h = _frame_size*size[1]/_sprite_h;
+    SDL_Rect destination_rect = {(int)std::lround(center[0] - w*0.5),
+                                 (int)std::lround(center[1] - h*0.5),
+                                 (int)std::lround(w),
+                                 (int)std::lround(h)};
+    SDL_RenderCopy(renderer, _atlas.get(), &source_rect, &destination_rect);
+}
 
-    
 }
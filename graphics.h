@@ -36,12 +36,115 @@ this restriction will be considered a breach of this License.
 #ifndef MCGGAME_GRAPHICS_H
 #define MCGGAME_GRAPHICS_H
 
+#include "engine.h"
 
+#include <cmath>
+#include <memory>
+#include <vector>
 
 namespace mcggame {
 
-    
-}
+/**
+ * @brief Part of the screen showing the world around a camera.
+ *
+ * Drawing into a view is done after SDL_RenderSetViewport(viewport), so
+ * screen coordinates are relative to the corner of the viewport.
+ */
+struct view_t {
+    SDL_Rect viewport;  ///< in logical screen coordinates
+    position_t camera;  ///< world point in the middle of the view
+    double scale;
+
+    position_t to_screen(const position_t &p) const {
+        return (p - camera)*scale + position_t{viewport.w*0.5, viewport.h*0.5};
+    }
+
+    /**
+     * @brief World coordinates of a point given in logical screen coordinates.
+     */
+    position_t from_screen(const position_t &p) const {
+        auto local = p - position_t{viewport.x + viewport.w*0.5, viewport.y + viewport.h*0.5};
+        return local*(1.0/scale) + camera;
+    }
+
+    bool contains_screen_point(const position_t &p) const {
+        return (p[0] >= viewport.x) && (p[0] < viewport.x + viewport.w) &&
+               (p[1] >= viewport.y) && (p[1] < viewport.y + viewport.h);
+    }
+
+    /**
+     * @brief true if a circle in the world can be seen in this view.
+     */
+    bool is_visible(const position_t &center, const double radius) const {
+        double half_w = viewport.w*0.5/scale + radius;
+        double half_h = viewport.h*0.5/scale + radius;
+        return (std::abs(center[0] - camera[0]) <= half_w) && (std::abs(center[1] - camera[1]) <= half_h);
+    }
+
+    /**
+     * @brief World pixels visible in this view, clipped to w x h; empty if none.
+     */
+    SDL_Rect visible_pixels(const int w, const int h) const;
+};
+
+/**
+ * @brief Splits a width x height screen into n viewports: rows of equal
+ * height, with as few columns as possible.
+ */
+std::vector<SDL_Rect> split_screen(const int n, const int width, const int height);
+
+/**
+ * @brief Bar in the middle of the screen, filled in the given fraction.
+ */
+void draw_progress_bar(SDL_Renderer *renderer, const double fraction);
+
+/**
+ * @brief Sprite pre-rotated to a fixed number of angles, all frames in one
+ * atlas texture.
+ *
+ * The frames are baked on the CPU once, so drawing is a plain
+ * SDL_RenderCopy of the nearest frame instead of a rotation resample in
+ * SDL_RenderCopyEx. This matters on the software renderer.
+ */
+class rotated_sprite_cache_c {
+    std::shared_ptr<SDL_Texture> _atlas;
+    int _frames;
+    int _columns;
+    int _frame_size;  ///< frames are square, large enough for the sprite at any angle
+    int _sprite_w;
+    int _sprite_h;
+public:
+    /**
+     * @param sprite unrotated sprite, the color key becomes transparent
+     * @param frames number of angles, evenly spread over the full turn
+     */
+    rotated_sprite_cache_c(SDL_Renderer *renderer, SDL_Surface *sprite, const int frames);
+
+    int frames() const { return _frames; }
+
+    /**
+     * @brief Frame nearest to the angle, in radians as in SDL_RenderCopyEx (clockwise on the screen).
+     */
+    int frame_index(const double angle) const;
+
+    SDL_Rect frame_rect(const int frame) const;
+
+    /**
+     * @brief Draws the sprite rotated by angle.
+     *
+     * @param center screen position of the center of the sprite
+     * @param size screen size of the unrotated sprite
+     */
+    void draw(SDL_Renderer *renderer, const position_t &center, const position_t &size, const double angle) const;
+};
+
+/**
+ * @brief Rotates the ARGB8888 surface source by angle around its center
+ * into the middle of the ARGB8888 surface target, with bilinear filtering.
+ * Pixels outside of the source are transparent.
+ */
+void rotate_surface(SDL_Surface *source, SDL_Surface *target, const SDL_Rect &target_rect, const double angle);
 
+}
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,204 @@
+/*
+
+MIT License with AI exception
+
+Copyright (c) Tadeusz Puźniakowski 2024
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is furnished
+to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+Additional restriction:
+
+The Software may not be used, in whole or in part, to teach or train any
+artificial intelligence system, including but not limited to large language
+models (LLMs), neural networks, or any other type of AI technology. Violation of
+this restriction will be considered a breach of this License.
+
+*/
+
+#include "net.h"
+
+#include <cmath>
+#include <stdexcept>
+#include <cstring>
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <errno.h>
+
+namespace mcggame {
+namespace net {
+
+quantized_car_t quantize(const car_state_t &car) {
+    return {
+        (int32_t)std::lround(car.p[0] / position_quantum),
+        (int32_t)std::lround(car.p[1] / position_quantum),
+        (int32_t)std::lround(car.v[0] / position_quantum),
+        (int32_t)std::lround(car.v[1] / position_quantum),
+        (int32_t)std::lround(angle_crop_to_range(car.angle) / angle_quantum)
+    };
+}
+
+car_state_t dequantize(const quantized_car_t &car) {
+    return {
+        {car.x * position_quantum, car.y * position_quantum},
+        {car.vx * position_quantum, car.vy * position_quantum},
+        {0.0, 0.0},
+        angle_crop_to_range(car.angle * angle_quantum)
+    };
+}
+
+void byte_writer_t::varint(uint64_t v) {
+    while (v >= 0x80) {
+        data.push_back((uint8_t)(v | 0x80));
+        v >>= 7;
+    }
+    data.push_back((uint8_t)v);
+}
+
+uint8_t byte_reader_t::u8() {
+    if (_p >= _end) {
+        ok = false;
+        return 0;
+    }
+    return *_p++;
+}
+
+uint64_t byte_reader_t::varint() {
+    uint64_t v = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        uint8_t b = u8();
+        v |= (uint64_t)(b & 0x7f) << shift;
+        if (!(b & 0x80)) return v;
+    }
+    ok = false;
+    return 0;
+}
+
+void write_snapshot(byte_writer_t &w, const snapshot_t &snapshot, const snapshot_t *baseline) {
+    static const quantized_car_t zero = {0, 0, 0, 0, 0};
+    w.varint(snapshot.tick);
+    w.varint(baseline ? baseline->tick : 0);
+    w.varint(snapshot.input_ack);
+    w.varint(snapshot.your_car);
+    w.varint(snapshot.cars.size());
+    for (size_t i = 0; i < snapshot.cars.size(); i++) {
+        const auto &car = snapshot.cars[i];
+        const auto &base = (baseline && (i < baseline->cars.size())) ? baseline->cars[i] : zero;
+        w.svarint((int64_t)car.x - base.x);
+        w.svarint((int64_t)car.y - base.y);
+        w.svarint((int64_t)car.vx - base.vx);
+        w.svarint((int64_t)car.vy - base.vy);
+        w.svarint((int64_t)car.angle - base.angle);
+    }
+}
+
+bool read_snapshot(byte_reader_t &r, snapshot_t &snapshot, const std::function<const snapshot_t *(uint32_t tick)> &find_baseline) {
+    static const quantized_car_t zero = {0, 0, 0, 0, 0};
+    snapshot.tick = r.varint();
+    uint32_t baseline_tick = r.varint();
+    snapshot.input_ack = r.varint();
+    snapshot.your_car = r.varint();
+    size_t count = r.varint();
+    if (!r.ok || (count > max_packet_size)) return false;
+    const snapshot_t *baseline = nullptr;
+    if (baseline_tick != 0) {
+        baseline = find_baseline(baseline_tick);
+        if (!baseline) return false;
+    }
+    snapshot.cars.resize(count);
+    for (size_t i = 0; i < count; i++) {
+        const auto &base = (baseline && (i < baseline->cars.size())) ? baseline->cars[i] : zero;
+        auto &car = snapshot.cars[i];
+        car.x = base.x + r.svarint();
+        car.y = base.y + r.svarint();
+        car.vx = base.vx + r.svarint();
+        car.vy = base.vy + r.svarint();
+        car.angle = base.angle + r.svarint();
+    }
+    return r.ok;
+}
+
+address_t resolve_address(const std::string &host_port) {
+    auto colon = host_port.rfind(':');
+    if (colon == std::string::npos) throw std::invalid_argument("address should be host:port, got " + host_port);
+    std::string host = host_port.substr(0, colon);
+    std::string port = host_port.substr(colon + 1);
+    addrinfo hints;
+    std::memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_DGRAM;
+    addrinfo *result = nullptr;
+    if (getaddrinfo(host.c_str(), port.c_str(), &hints, &result) || !result) {
+        throw std::runtime_error("could not resolve " + host_port);
+    }
+    auto *in = (sockaddr_in *)result->ai_addr;
+    address_t ret = {ntohl(in->sin_addr.s_addr), ntohs(in->sin_port)};
+    freeaddrinfo(result);
+    return ret;
+}
+
+udp_socket_c::udp_socket_c(const uint16_t port) {
+    _fd = socket(AF_INET, SOCK_DGRAM, 0);
+    if (_fd < 0) throw std::runtime_error(std::string("socket: ") + std::strerror(errno));
+    sockaddr_in local;
+    std::memset(&local, 0, sizeof(local));
+    local.sin_family = AF_INET;
+    local.sin_addr.s_addr = htonl(INADDR_ANY);
+    local.sin_port = htons(port);
+    if ((bind(_fd, (sockaddr *)&local, sizeof(local)) < 0) || (fcntl(_fd, F_SETFL, fcntl(_fd, F_GETFL) | O_NONBLOCK) < 0)) {
+        std::string error = std::strerror(errno);
+        close(_fd);
+        throw std::runtime_error("could not open udp port " + std::to_string(port) + ": " + error);
+    }
+}
+
+udp_socket_c::~udp_socket_c() {
+    close(_fd);
+}
+
+void udp_socket_c::send(const address_t &to, const std::vector<uint8_t> &data) {
+    sockaddr_in remote;
+    std::memset(&remote, 0, sizeof(remote));
+    remote.sin_family = AF_INET;
+    remote.sin_addr.s_addr = htonl(to.ip);
+    remote.sin_port = htons(to.port);
+    // a lost datagram is like a lost packet, the protocol repairs both
+    sendto(_fd, data.data(), data.size(), 0, (sockaddr *)&remote, sizeof(remote));
+}
+
+bool udp_socket_c::receive(std::vector<uint8_t> &data, address_t &from) {
+    sockaddr_in remote;
+    socklen_t remote_size = sizeof(remote);
+    data.resize(2048);
+    auto n = recvfrom(_fd, data.data(), data.size(), 0, (sockaddr *)&remote, &remote_size);
+    if (n < 0) {
+        data.clear();
+        return false;
+    }
+    data.resize(n);
+    from = {ntohl(remote.sin_addr.s_addr), ntohs(remote.sin_port)};
+    return true;
+}
+
+}
+}
@@ -0,0 +1,164 @@
+/*
+
+MIT License with AI exception
+
+Copyright (c) Tadeusz Puźniakowski 2024
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is furnished
+to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+Additional restriction:
+
+The Software may not be used, in whole or in part, to teach or train any
+artificial intelligence system, including but not limited to large language
+models (LLMs), neural networks, or any other type of AI technology. Violation of
+this restriction will be considered a breach of this License.
+
+*/
+
+
+
+#ifndef MCGGAME_NET_H
+#define MCGGAME_NET_H
+
+#include "engine.h"
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace mcggame {
+namespace net {
+
+enum class packet_type_e : uint8_t {
+    JOIN = 1,     ///< client -> server: room
+    WELCOME = 2,  ///< server -> client: car index
+    INPUT = 3,    ///< client -> server: room, acked snapshot tick, newest inputs
+    SNAPSHOT = 4  ///< server -> client: tick, baseline tick, input ack, your car, cars
+};
+
+/// positions and velocities are sent in 1/16 of a pixel
+const double position_quantum = 1.0/16.0;
+/// the angle is sent in 1/65536 of the full turn
+const double angle_quantum = 2.0*M_PI/65536.0;
+/// largest packet the server sends
+const size_t max_packet_size = 1200;
+
+struct quantized_car_t {
+    int32_t x;
+    int32_t y;
+    int32_t vx;
+    int32_t vy;
+    int32_t angle;
+};
+
+quantized_car_t quantize(const car_state_t &car);
+car_state_t dequantize(const quantized_car_t &car);
+
+struct snapshot_t {
+    uint32_t tick = 0;
+    uint32_t input_ack = 0;  ///< last input sequence number the server applied for the receiver
+    uint32_t your_car = 0;
+    std::vector<quantized_car_t> cars;
+};
+
+class byte_writer_t {
+public:
+    std::vector<uint8_t> data;
+
+    void u8(const uint8_t v) { data.push_back(v); }
+    void i8(const int8_t v) { data.push_back((uint8_t)v); }
+    void varint(uint64_t v);
+    /// zigzag encoded, so small negative numbers are short too
+    void svarint(const int64_t v) { varint(((uint64_t)v << 1) ^ (uint64_t)(v >> 63)); }
+};
+
+/**
+ * @brief Reads what byte_writer_t wrote. Reading past the end sets ok to
+ * false and returns zeros, so a truncated packet is checked only once.
+ */
+class byte_reader_t {
+    const uint8_t *_p;
+    const uint8_t *_end;
+public:
+    bool ok = true;
+
+    byte_reader_t(const std::vector<uint8_t> &data) : _p(data.data()), _end(data.data() + data.size()) {}
+
+    uint8_t u8();
+    int8_t i8() { return (int8_t)u8(); }
+    uint64_t varint();
+    int64_t svarint() { auto v = varint(); return (int64_t)(v >> 1) ^ -(int64_t)(v & 1); }
+    bool at_end() const { return _p == _end; }
+};
+
+/**
+ * @brief Writes the snapshot as a delta to the baseline, if there is one.
+ * Every field is the zigzag varint of the difference to the same car in the
+ * baseline, so a car that did not move takes five bytes.
+ */
+void write_snapshot(byte_writer_t &w, const snapshot_t &snapshot, const snapshot_t *baseline);
+
+/**
+ * @brief Reads a snapshot written by write_snapshot. find_baseline returns
+ * the snapshot with the given tick, or nullptr if it is not known anymore.
+ *
+ * @return false if the packet was broken or its baseline is unknown
+ */
+bool read_snapshot(byte_reader_t &r, snapshot_t &snapshot, const std::function<const snapshot_t *(uint32_t tick)> &find_baseline);
+
+struct address_t {
+    uint32_t ip;    ///< host byte order
+    uint16_t port;  ///< host byte order
+
+    bool operator==(const address_t &o) const { return (ip == o.ip) && (port == o.port); }
+    bool operator!=(const address_t &o) const { return !(*this == o); }
+};
+
+/**
+ * @brief Resolves "host:port" to an IPv4 address.
+ */
+address_t resolve_address(const std::string &host_port);
+
+/**
+ * @brief Non blocking IPv4 UDP socket.
+ */
+class udp_socket_c {
+    int _fd;
+public:
+    /**
+     * @param port local port, 0 for any
+     */
+    udp_socket_c(const uint16_t port = 0);
+    udp_socket_c(const udp_socket_c &) = delete;
+    udp_socket_c &operator=(const udp_socket_c &) = delete;
+    virtual ~udp_socket_c();
+
+    void send(const address_t &to, const std::vector<uint8_t> &data);
+
+    /**
+     * @return false if there is nothing to receive
+     */
+    bool receive(std::vector<uint8_t> &data, address_t &from);
+};
+
+}
+}
+
+#endif
@@ -0,0 +1,183 @@
+/*
+
+MIT License with AI exception
+
+Copyright (c) Tadeusz Puźniakowski 2024
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is furnished
+to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+Additional restriction:
+
+The Software may not be used, in whole or in part, to teach or train any
+artificial intelligence system, including but not limited to large language
+models (LLMs), neural networks, or any other type of AI technology. Violation of
+this restriction will be considered a breach of this License.
+
+*/
+
+
+
+#include "offscreen.h"
+
+#include <cctype>
+#include <cstring>
+#include <stdexcept>
+
+namespace mcggame {
+
+offscreen_target_c::offscreen_target_c(const int width, const int height) {
+    _surface = std::shared_ptr<SDL_Surface>(SDL_CreateRGBSurfaceWithFormat(0, width, height, 32, SDL_PIXELFORMAT_ARGB8888), [](auto p){SDL_FreeSurface(p);});
+    if (!_surface) {
+        throw std::runtime_error(SDL_GetError());
+    }
+    _renderer = SDL_CreateSoftwareRenderer(_surface.get());
+    if (!_renderer) {
+        throw std::runtime_error(SDL_GetError());
+    }
+    SDL_RenderSetLogicalSize(_renderer, game_view_width, game_view_height);
+}
+
+offscreen_target_c::~offscreen_target_c() {
+    SDL_DestroyRenderer(_renderer);
+}
+
+/**
+ * @brief Checks that the pattern of the frame file names has exactly one
+ * printf conversion of an int (flags, width and precision are fine), so
+ * snprintf never reads arguments it was not given.
+ */
+static void check_frame_pattern(const std::string &pattern) {
+    int conversions = 0;
+    for (size_t i = 0; i < pattern.size(); i++) {
+        if (pattern[i] != '%') continue;
+        if ((i + 1 < pattern.size()) && (pattern[i + 1] == '%')) {
+            i++;
+            continue;
+        }
+        i++;
+        while ((i < pattern.size()) && std::strchr("-+ #0", pattern[i])) i++;
+        while ((i < pattern.size()) && std::isdigit((unsigned char)pattern[i])) i++;
+        if ((i < pattern.size()) && (pattern[i] == '.')) {
+            i++;
+            while ((i < pattern.size()) && std::isdigit((unsigned char)pattern[i])) i++;
+        }
+        if ((i == pattern.size()) || !std::strchr("diouxX", pattern[i]))
+            throw std::invalid_argument("the frame file pattern may only have int conversions like %05d: " + pattern);
+        conversions++;
+    }
+    if (conversions != 1)
+        throw std::invalid_argument("the frame file pattern needs exactly one frame number like %05d: " + pattern);
+}
+
+frame_writer_c::frame_writer_c(const std::string &destination, const size_t max_queued) : _destination(destination), _max_queued(max_queued) {
+    if (_destination != "-") check_frame_pattern(_destination);
+    _thread = std::thread([this]() { writer(); });
+}
+
+frame_writer_c::~frame_writer_c() {
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _closing = true;
+    }
+    _changed.notify_all();
+    _thread.join();
+}
+
+void frame_writer_c::write(const SDL_Surface *frame) {
+    std::shared_ptr<SDL_Surface> copy;
+    {
+        std::unique_lock<std::mutex> lock(_mutex);
+        _changed.wait(lock, [this]() { return (_queue.size() < _max_queued) || !_error.empty(); });
+        if (!_error.empty()) throw std::runtime_error(_error);
+        if (!_free.empty()) {
+            copy = _free.back();
+            _free.pop_back();
+        }
+    }
+    if (!copy || (copy->w != frame->w) || (copy->h != frame->h)) {
+        copy = std::shared_ptr<SDL_Surface>(SDL_CreateRGBSurfaceWithFormat(0, frame->w, frame->h, 32, SDL_PIXELFORMAT_ARGB8888), [](auto p){SDL_FreeSurface(p);});
+        if (!copy) {
+            throw std::runtime_error(SDL_GetError());
+        }
+    }
+    for (int y = 0; y < frame->h; y++)
+        std::memcpy((uint8_t *)copy->pixels + y*copy->pitch, (const uint8_t *)frame->pixels + y*frame->pitch, frame->w*4);
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _queue.push_back(copy);
+    }
+    _changed.notify_all();
+}
+
+void frame_writer_c::flush() {
+    std::unique_lock<std::mutex> lock(_mutex);
+    _changed.wait(lock, [this]() { return _queue.empty() || !_error.empty(); });
+    if (!_error.empty()) throw std::runtime_error(_error);
+}
+
+int frame_writer_c::frames_written() {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _frames_written;
+}
+
+void frame_writer_c::write_frame(SDL_Surface *frame, const int index) {
+    if (_destination == "-") {
+        for (int y = 0; y < frame->h; y++)
+            if (std::fwrite((uint8_t *)frame->pixels + y*frame->pitch, 4, frame->w, stdout) != (size_t)frame->w)
+                throw std::runtime_error("could not write the frame to the standard output");
+        return;
+    }
+    std::vector<char> fname(std::snprintf(nullptr, 0, _destination.c_str(), index) + 1);
+    std::snprintf(fname.data(), fname.size(), _destination.c_str(), index);
+    if (SDL_SaveBMP(frame, fname.data())) {
+        throw std::runtime_error(SDL_GetError());
+    }
+}
+
+void frame_writer_c::writer() {
+    for (;;) {
+        std::shared_ptr<SDL_Surface> frame;
+        int index;
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            _changed.wait(lock, [this]() { return _closing || !_queue.empty(); });
+            if (_queue.empty()) break;
+            // the frame stays queued while it is written, so flush() waits for it
+            frame = _queue.front();
+            index = _frames_written;
+        }
+        std::string error;
+        try {
+            if (_error.empty()) write_frame(frame.get(), index);
+        } catch (const std::exception &e) {
+            error = e.what();
+        }
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _queue.pop_front();
+            if (!error.empty()) _error = error;
+            else if (_error.empty()) _frames_written++;
+            _free.push_back(frame);
+        }
+        _changed.notify_all();
+    }
+    if (_destination == "-") std::fflush(stdout);
+}
+
+}
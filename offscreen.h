@@ -0,0 +1,125 @@
+/*
+
+MIT License with AI exception
+
+Copyright (c) Tadeusz Puźniakowski 2024
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is furnished
+to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+Additional restriction:
+
+The Software may not be used, in whole or in part, to teach or train any
+artificial intelligence system, including but not limited to large language
+models (LLMs), neural networks, or any other type of AI technology. Violation of
+this restriction will be considered a breach of this License.
+
+*/
+
+
+
+#ifndef MCGGAME_OFFSCREEN_H
+#define MCGGAME_OFFSCREEN_H
+
+#include "engine.h"
+
+#include <condition_variable>
+#include <cstdio>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace mcggame {
+
+/**
+ * @brief Draws with the software renderer into an ARGB8888 surface, no
+ * window or display needed. The logical size is the game view, so the same
+ * drawing code works for any output size.
+ */
+class offscreen_target_c : public render_target_i {
+    std::shared_ptr<SDL_Surface> _surface;
+    SDL_Renderer *_renderer;
+public:
+    offscreen_target_c(const int width = game_view_width, const int height = game_view_height);
+    offscreen_target_c(const offscreen_target_c &) = delete;
+    offscreen_target_c &operator=(const offscreen_target_c &) = delete;
+    virtual ~offscreen_target_c();
+
+    SDL_Renderer *get_renderer() const { return _renderer; }
+    void present() { SDL_RenderPresent(_renderer); }
+
+    /**
+     * @brief The pixels of the last presented frame.
+     */
+    SDL_Surface *surface() const { return _surface.get(); }
+};
+
+/**
+ * @brief Writes frames on its own thread.
+ *
+ * The destination "-" streams raw ARGB8888 frames to the standard output,
+ * one after another without headers, e.g. for
+ * ffmpeg -f rawvideo -pixel_format bgra -video_size 640x480 -i -
+ * Any other destination is a printf pattern of BMP file names, like
+ * "replay/frame_%05d.bmp", with exactly one int conversion for the frame
+ * number; the constructor throws std::invalid_argument otherwise. At most max_queued frames wait for the writer;
+ * when it falls behind, write() blocks, so memory use stays bounded.
+ */
+class frame_writer_c {
+    std::string _destination;
+    size_t _max_queued;
+
+    std::mutex _mutex;
+    std::condition_variable _changed;
+    std::deque<std::shared_ptr<SDL_Surface>> _queue;
+    std::vector<std::shared_ptr<SDL_Surface>> _free;  ///< written frames, reused for the next copies
+    bool _closing = false;
+    std::string _error;
+    int _frames_written = 0;
+    std::thread _thread;
+
+    void writer();
+    void write_frame(SDL_Surface *frame, const int index);
+public:
+    frame_writer_c(const std::string &destination, const size_t max_queued = 8);
+    frame_writer_c(const frame_writer_c &) = delete;
+    frame_writer_c &operator=(const frame_writer_c &) = delete;
+    /**
+     * @brief Writes the frames still in the queue.
+     */
+    virtual ~frame_writer_c();
+
+    /**
+     * @brief Queues a copy of the frame. Throws if writing failed before.
+     */
+    void write(const SDL_Surface *frame);
+
+    /**
+     * @brief Waits until the queued frames are written. Throws if writing failed.
+     */
+    void flush();
+
+    int frames_written();
+};
+
+}
+
+#endif
@@ -0,0 +1,64 @@
+/*
+
+MIT License with AI exception
+
+Copyright (c) Tadeusz Puźniakowski 2024
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is furnished
+to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+Additional restriction:
+
+The Software may not be used, in whole or in part, to teach or train any
+artificial intelligence system, including but not limited to large language
+models (LLMs), neural networks, or any other type of AI technology. Violation of
+this restriction will be considered a breach of this License.
+
+*/
+
+#include "physics.h"
+
+#include <stdexcept>
+#include <utility>
+
+namespace mcggame {
+
+static const std::vector<std::pair<std::string, car_physics_fn>> physics_models = {
+    {"arcade", &arcade_physics::step},
+    {"arcade-euler", &car_physics<semi_implicit_euler_integrator, linear_friction<arcade_constants>, grip_steering<arcade_constants>>::step},
+    {"arcade-verlet", &car_physics<velocity_verlet_integrator, linear_friction<arcade_constants>, grip_steering<arcade_constants>>::step},
+    {"arcade-fixed", &fixed_car_physics<arcade_constants>::step},
+    {"drift", &drift_physics::step},
+    {"drift-euler", &car_physics<semi_implicit_euler_integrator, linear_friction<drift_constants>, grip_steering<drift_constants>, drift_constants>::step},
+    {"drift-verlet", &car_physics<velocity_verlet_integrator, linear_friction<drift_constants>, grip_steering<drift_constants>, drift_constants>::step},
+    {"drift-fixed", &fixed_car_physics<drift_constants>::step},
+};
+
+car_physics_fn physics_model_from_string(const std::string &name) {
+    for (const auto &model : physics_models)
+        if (model.first == name) return model.second;
+    throw std::invalid_argument("unknown physics model: " + name);
+}
+
+std::vector<std::string> physics_model_names() {
+    std::vector<std::string> ret;
+    for (const auto &model : physics_models) ret.push_back(model.first);
+    return ret;
+}
+
+}
@@ -0,0 +1,241 @@
+/*
+
+MIT License with AI exception
+
+Copyright (c) Tadeusz Puźniakowski 2024
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is furnished
+to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+Additional restriction:
+
+The Software may not be used, in whole or in part, to teach or train any
+artificial intelligence system, including but not limited to large language
+models (LLMs), neural networks, or any other type of AI technology. Violation of
+this restriction will be considered a breach of this License.
+
+*/
+
+
+
+#ifndef MCGGAME_PHYSICS_H
+#define MCGGAME_PHYSICS_H
+
+#include "engine.h"
+#include "fixed_point.h"
+
+#include <cmath>
+#include <string>
+#include <vector>
+
+namespace mcggame {
+
+/*
+ * Car physics is composed from three policies:
+ *
+ * Integrator::step(p, v, a, accel, dt) advances the position and velocity,
+ *     a is the acceleration at the start of the step and accel(v) gives the
+ *     acceleration for another velocity.
+ * Friction::acceleration(v, drifting) is the friction for the velocity v.
+ * Steering::steer(state, input, v, angle, drifting) turns the car and pulls
+ *     the velocity towards the direction of the car.
+ *
+ * All constants are static constexpr members, so car_physics<...>::step
+ * compiles into one kernel without calls or lookups.
+ */
+
+/**
+ * @brief Exact integration for a constant acceleration over the step.
+ */
+struct kinematic_integrator {
+    template <class Accel>
+    static void step(position_t &p, position_t &v, position_t &a, const Accel &, const double dt) {
+        p = p + v * dt + a*dt*dt/2.0;
+        v = v + a*dt;
+    }
+};
+
+struct semi_implicit_euler_integrator {
+    template <class Accel>
+    static void step(position_t &p, position_t &v, position_t &a, const Accel &, const double dt) {
+        v = v + a*dt;
+        p = p + v*dt;
+    }
+};
+
+/**
+ * @brief Velocity Verlet. The acceleration depends on the velocity through
+ * friction, so it is evaluated again for the predicted velocity.
+ */
+struct velocity_verlet_integrator {
+    template <class Accel>
+    static void step(position_t &p, position_t &v, position_t &a, const Accel &accel, const double dt) {
+        p = p + v * dt + a*dt*dt/2.0;
+        auto a1 = accel(v + a*dt);
+        v = v + (a + a1)*(dt/2.0);
+        a = a1;
+    }
+};
+
+struct arcade_constants {
+    static constexpr double thrust = 160.0;         ///< acceleration at full throttle
+    static constexpr double friction = 0.5;         ///< rolling friction coefficient
+    static constexpr double drift_friction = 0.9;   ///< friction coefficient while drifting
+    static constexpr double moving_speed = 0.0001;  ///< below this the car does not steer nor brake
+    static constexpr double stop_speed = 0.005;     ///< the car stops below this speed after the step
+    static constexpr double slow_speed = 1.0;       ///< below this the velocity snaps to the car direction
+    static constexpr double grip = 0.02;            ///< part of the slip angle corrected every step
+    static constexpr double slow_grip = 0.9;
+    static constexpr double drift_grip = 0.02;
+    static constexpr double drift_speed = 100.0;    ///< above this speed slipping means drifting
+    static constexpr double drift_angle = 0.001;
+    static constexpr double turn_rate = 0.0001;     ///< turning per unit of speed
+};
+
+/**
+ * @brief Looser grip and faster turning, so the car slides out of corners.
+ */
+struct drift_constants : public arcade_constants {
+    static constexpr double drift_speed = 80.0;
+    static constexpr double drift_grip = 0.006;
+    static constexpr double drift_friction = 0.7;
+    static constexpr double turn_rate = 0.00014;
+};
+
+template <class C>
+struct linear_friction {
+    static position_t acceleration(const position_t &v, const bool drifting) {
+        if (~v < C::moving_speed) return {0.0, 0.0};
+        return v*(-(drifting ? C::drift_friction : C::friction));
+    }
+};
+
+template <class C>
+struct grip_steering {
+    static void steer(const car_state_t &s, const input_state_t &input, position_t &v, double &angle, bool &drifting) {
+        double speed = ~s.v;
+        if (!(speed > C::moving_speed)) return;
+        auto forward_vector = rotate_around({1.0,0.0}, s.angle);
+        auto backward_vector = rotate_around({-1.0,0.0}, s.angle);
+        auto angle_to_correct_a = angle_between_vectors(forward_vector, s.v);
+        auto angle_to_correct_b = angle_between_vectors(backward_vector, s.v);
+        bool is_moving_forward = (std::abs(angle_to_correct_a) < std::abs(angle_to_correct_b));
+        auto angle_to_correct = is_moving_forward?angle_to_correct_a:angle_to_correct_b;
+        drifting = (speed > C::drift_speed) && (std::abs(angle_to_correct) > C::drift_angle);
+        double grip = (speed > C::slow_speed) ? (drifting ? C::drift_grip : C::grip) : C::slow_grip;
+        v = rotate_around(s.v, -(angle_to_correct * grip));
+        double turn_rate = is_moving_forward ? C::turn_rate : -C::turn_rate;
+        angle = angle_crop_to_range(s.angle + input.p[0]*turn_rate*speed);
+    }
+};
+
+template <class Integrator, class Friction, class Steering, class C = arcade_constants>
+struct car_physics {
+    static car_state_t step(const car_state_t &s, const input_state_t &input, const double dt) {
+        car_state_t ret = s;
+        bool drifting = false;
+        auto forward_vector = rotate_around({1.0,0.0}, s.angle);
+        auto thrust = forward_vector * input.p[1]*C::thrust;
+
+        Steering::steer(s, input, ret.v, ret.angle, drifting);
+
+        ret.a = thrust + Friction::acceleration(s.v, drifting);
+        auto accel = [&](const position_t &v) { return thrust + Friction::acceleration(v, drifting); };
+        Integrator::step(ret.p, ret.v, ret.a, accel, dt);
+        if (~ret.v < C::stop_speed) {
+            ret.v = {0.0,0.0};
+        }
+        return ret;
+    }
+};
+
+using arcade_physics = car_physics<kinematic_integrator, linear_friction<arcade_constants>, grip_steering<arcade_constants>>;
+using drift_physics = car_physics<kinematic_integrator, linear_friction<drift_constants>, grip_steering<drift_constants>, drift_constants>;
+
+/**
+ * @brief The kinematic model with the grip steering, computed in fixed point.
+ *
+ * The state is still exchanged as doubles, but it goes through fixed point
+ * unchanged, and the step itself is integer math only. Given the same state
+ * and input the result has the same bits on every machine and build.
+ */
+template <class C = arcade_constants>
+struct fixed_car_physics {
+    static car_state_t step(const car_state_t &s, const input_state_t &input, const double dt) {
+        using namespace fixed;
+        static constexpr fixed_t thrust = fixed_t::from_double(C::thrust);
+        static constexpr fixed_t friction = fixed_t::from_double(C::friction);
+        static constexpr fixed_t drift_friction = fixed_t::from_double(C::drift_friction);
+        static constexpr fixed_t moving_speed = fixed_t::from_double(C::moving_speed);
+        static constexpr fixed_t stop_speed = fixed_t::from_double(C::stop_speed);
+        static constexpr fixed_t slow_speed = fixed_t::from_double(C::slow_speed);
+        static constexpr fixed_t grip = fixed_t::from_double(C::grip);
+        static constexpr fixed_t slow_grip = fixed_t::from_double(C::slow_grip);
+        static constexpr fixed_t drift_grip = fixed_t::from_double(C::drift_grip);
+        static constexpr fixed_t drift_speed = fixed_t::from_double(C::drift_speed);
+        static constexpr int64_t drift_angle = (int64_t)(C::drift_angle * angle_units_per_radian);
+        static constexpr fixed_t turn_rate = fixed_t::from_double(C::turn_rate * angle_units_per_radian);
+
+        fixed_vec_t p = fixed_vec_t::from_position(s.p);
+        fixed_vec_t v = fixed_vec_t::from_position(s.v);
+        angle_t angle = angle_from_radians(s.angle);
+        fixed_t h = fixed_t::from_double(dt);
+
+        fixed_vec_t forward_vector = {cos(angle), sin(angle)};
+        fixed_vec_t forward_acceleration = forward_vector * (fixed_t::from_double(input.p[1]) * thrust);
+
+        fixed_t speed = length(v);
+        bool drifting = false;
+        fixed_vec_t new_v = v;
+        if (speed > moving_speed) {
+            angle_t direction = atan2(v.y, v.x);
+            int64_t angle_to_correct_a = (int32_t)(direction - angle);
+            int64_t angle_to_correct_b = (int32_t)(direction - (angle + half_turn));
+            bool is_moving_forward = std::abs(angle_to_correct_a) < std::abs(angle_to_correct_b);
+            int64_t angle_to_correct = is_moving_forward ? angle_to_correct_a : angle_to_correct_b;
+            drifting = (speed > drift_speed) && (std::abs(angle_to_correct) > drift_angle);
+            fixed_t g = (speed > slow_speed) ? (drifting ? drift_grip : grip) : slow_grip;
+            new_v = rotate(v, (angle_t)-((angle_to_correct * g.raw) >> fixed_t::fraction_bits));
+            fixed_t turn = fixed_t::from_double(input.p[0]) * turn_rate * speed;
+            angle += (angle_t)(is_moving_forward ? (turn.raw >> fixed_t::fraction_bits) : -(turn.raw >> fixed_t::fraction_bits));
+        }
+
+        fixed_vec_t a = forward_acceleration;
+        if (speed >= moving_speed) a = a - v * (drifting ? drift_friction : friction);
+
+        p = p + new_v * h + a * (h * h * fixed_t::from_double(0.5));
+        new_v = new_v + a * h;
+        if (length(new_v) < stop_speed) new_v = {};
+
+        return {p.to_position(), new_v.to_position(), a.to_position(), angle_to_radians(angle)};
+    }
+};
+
+using car_physics_fn = car_state_t (*)(const car_state_t &s, const input_state_t &input, const double dt);
+
+/**
+ * @brief Physics model by name: arcade (the default), arcade-euler,
+ * arcade-verlet, arcade-fixed, drift, drift-euler, drift-verlet and
+ * drift-fixed.
+ */
+car_physics_fn physics_model_from_string(const std::string &name);
+std::vector<std::string> physics_model_names();
+
+}
+
+#endif
@@ -0,0 +1,308 @@
+/*
+
+MIT License with AI exception
+
+Copyright (c) Tadeusz Puźniakowski 2024
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is furnished
+to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+Additional restriction:
+
+The Software may not be used, in whole or in part, to teach or train any
+artificial intelligence system, including but not limited to large language
+models (LLMs), neural networks, or any other type of AI technology. Violation of
+this restriction will be considered a breach of this License.
+
+*/
+
+#include "server.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+namespace mcggame {
+
+/// snapshots kept as possible baselines, on the server and on the client
+static const size_t snapshot_history_size = 64;
+/// inputs repeated in every input packet, so a lost packet loses no input
+static const size_t input_redundancy = 8;
+static const std::chrono::seconds client_timeout(5);
+static const std::chrono::milliseconds join_retry(250);
+/// inputs a client may have queued on the server, as many as the client keeps unacknowledged
+static const size_t max_queued_inputs = snapshot_history_size*2;
+
+static uint64_t address_key(const net::address_t &a) {
+    return ((uint64_t)a.ip << 16) | a.port;
+}
+
+static int8_t quantize_input(const double v) {
+    return (int8_t)std::lround(std::clamp(v, -1.0, 1.0) * 127.0);
+}
+
+server_c::server_c(const uint16_t port, std::shared_ptr<race_track_t> race_track, const car_t &car_prototype, const double dt, const int snapshot_interval, const size_t max_players) :
+    _socket(port), _race_track(race_track), _car_prototype(car_prototype), _dt(dt), _snapshot_interval(std::max(1, snapshot_interval)), _max_players(max_players) {
+}
+
+void server_c::send(const net::address_t &to, const std::vector<uint8_t> &data) {
+    _socket.send(to, data);
+    _stats.packets_sent++;
+    _stats.bytes_sent += data.size();
+}
+
+void server_c::handle_join(const net::address_t &from, net::byte_reader_t &r) {
+    uint32_t room_id = r.varint();
+    if (!r.ok) return;
+    auto key = address_key(from);
+    auto found = _clients.find(key);
+    if (found == _clients.end()) {
+        auto &room = _rooms[room_id];
+        // the cars of clients that timed out stay parked until someone takes their place
+        std::vector<bool> taken(room.cars.size(), false);
+        for (const auto &[k, c] : _clients)
+            if (c.room == room_id) taken[c.car] = true;
+        size_t slot = std::find(taken.begin(), taken.end(), false) - taken.begin();
+        if ((slot == room.cars.size()) && (room.cars.size() >= _max_players)) return;
+        client_t client;
+        client.address = from;
+        client.room = room_id;
+        client.car = slot;
+        client.input = std::make_shared<input_network_c>();
+        car_t car = _car_prototype;
+        car.input = client.input;
+        car.collision_cache = std::make_shared<collision_cache_c>();
+        car = place_car_on_race_track(*_race_track, car);
+        if (slot < room.cars.size()) room.cars[slot] = car;
+        else room.cars.push_back(car);
+        found = _clients.insert({key, client}).first;
+        std::cout << "client joined room " << room_id << " as car " << client.car << std::endl;
+    }
+    found->second.last_seen = std::chrono::steady_clock::now();
+    // the welcome is sent again for every join, it could have been lost
+    net::byte_writer_t w;
+    w.u8((uint8_t)net::packet_type_e::WELCOME);
+    w.varint(found->second.car);
+    send(from, w.data);
+}
+
+void server_c::handle_input(const net::address_t &from, net::byte_reader_t &r) {
+    auto found = _clients.find(address_key(from));
+    if (found == _clients.end()) return;
+    auto &client = found->second;
+    uint32_t room_id = r.varint();
+    uint32_t acked_tick = r.varint();
+    uint32_t newest = r.varint();
+    size_t count = std::min<size_t>(r.varint(), input_redundancy);
+    if (!r.ok || (room_id != client.room)) return;
+    for (size_t i = 0; (i < count) && (i <= newest); i++) {
+        double x = r.i8() / 127.0;
+        double y = r.i8() / 127.0;
+        uint32_t seq = newest - i;
+        if (r.ok && (seq > client.input_ack)) client.inputs[seq] = {{x, y}};
+    }
+    // sequence numbers come from the client, far ahead ones must not grow the queue without limit
+    while (client.inputs.size() > max_queued_inputs) client.inputs.erase(client.inputs.begin());
+    client.acked_tick = std::max(client.acked_tick, acked_tick);
+    client.last_seen = std::chrono::steady_clock::now();
+}
+
+void server_c::receive() {
+    std::vector<uint8_t> data;
+    net::address_t from;
+    while (_socket.receive(data, from)) {
+        net::byte_reader_t r(data);
+        auto type = (net::packet_type_e)r.u8();
+        if (type == net::packet_type_e::JOIN) handle_join(from, r);
+        else if (type == net::packet_type_e::INPUT) handle_input(from, r);
+    }
+}
+
+void server_c::step_room(const uint32_t room_id, room_t &room) {
+    for (auto &[key, client] : _clients) {
+        if (client.room != room_id) continue;
+        // one input per tick; when the next one is late the last one is repeated
+        auto next = client.inputs.upper_bound(client.input_ack);
+        if (next != client.inputs.end()) {
+            client.input->state = next->second;
+            client.input_ack = next->first;
+            client.inputs.erase(client.inputs.begin(), ++next);
+        }
+    }
+
+    std::vector<position_t> collisions;
+    room.cars = simulation_step(room.cars, _race_track, _dt, collisions, _params, &_stats.repair);
+    room.tick++;
+
+    net::snapshot_t snapshot;
+    snapshot.tick = room.tick;
+    for (const auto &car : room.cars) snapshot.cars.push_back(net::quantize(car.state()));
+    room.history.push_back(snapshot);
+    if (room.history.size() > snapshot_history_size) room.history.pop_front();
+
+    if ((room.tick % _snapshot_interval) != 0) return;
+    for (auto &[key, client] : _clients) {
+        if (client.room != room_id) continue;
+        const net::snapshot_t *baseline = nullptr;
+        for (const auto &s : room.history)
+            if (s.tick == client.acked_tick) baseline = &s;
+        snapshot.input_ack = client.input_ack;
+        snapshot.your_car = client.car;
+        net::byte_writer_t w;
+        w.u8((uint8_t)net::packet_type_e::SNAPSHOT);
+        net::write_snapshot(w, snapshot, baseline);
+        send(client.address, w.data);
+    }
+}
+
+void server_c::step() {
+    auto start = std::chrono::steady_clock::now();
+    receive();
+
+    for (auto it = _clients.begin(); it != _clients.end();) {
+        if (start - it->second.last_seen > client_timeout) {
+            std::cout << "client of room " << it->second.room << " timed out, car " << it->second.car << " is parked" << std::endl;
+            it->second.input->state = {{0.0, 0.0}};
+            it = _clients.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    for (auto it = _rooms.begin(); it != _rooms.end();) {
+        bool has_clients = std::any_of(_clients.begin(), _clients.end(), [&](const auto &c) { return c.second.room == it->first; });
+        if (has_clients) {
+            step_room(it->first, it->second);
+            ++it;
+        } else {
+            it = _rooms.erase(it);
+        }
+    }
+
+    _stats.rooms = _rooms.size();
+    _stats.clients = _clients.size();
+    _stats.ticks++;
+    _stats.step_time += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+void server_c::set_simulation(const simulation_params_t &params, const car_physics_fn physics) {
+    _params = params;
+    _car_prototype.physics = physics;
+    for (auto &[id, room] : _rooms)
+        for (auto &car : room.cars) car.physics = physics;
+}
+
+client_c::client_c(const net::address_t &server, const uint32_t room, std::shared_ptr<race_track_t> race_track, const car_t &car, const double dt, const simulation_params_t &params) :
+    _server(server), _room(room), _race_track(race_track), _dt(dt), _params(params), _predicted(car) {
+    _input = std::make_shared<input_network_c>();
+    _predicted.input = _input;
+}
+
+void client_c::predict(const input_state_t &input) {
+    std::vector<position_t> collisions;
+    _input->state = input;
+    _predicted = simulation_step({_predicted}, _race_track, _dt, collisions, _params)[0];
+}
+
+void client_c::set_simulation(const simulation_params_t &params, const car_physics_fn physics) {
+    _params = params;
+    _predicted.physics = physics;
+}
+
+void client_c::reconcile(const net::snapshot_t &snapshot) {
+    if (snapshot.your_car >= snapshot.cars.size()) return;
+    auto state = net::dequantize(snapshot.cars[snapshot.your_car]);
+    _predicted.set_state(state);
+    while (!_pending.empty() && (_pending.front().first <= snapshot.input_ack)) _pending.pop_front();
+    for (const auto &[seq, input] : _pending) predict(input);
+}
+
+void client_c::receive() {
+    std::vector<uint8_t> data;
+    net::address_t from;
+    while (_socket.receive(data, from)) {
+        if (from != _server) continue;
+        net::byte_reader_t r(data);
+        auto type = (net::packet_type_e)r.u8();
+        if (type == net::packet_type_e::WELCOME) {
+            r.varint();
+            if (r.ok && !_joined) {
+                _joined = true;
+                std::cout << "joined room " << _room << std::endl;
+            }
+        } else if (type == net::packet_type_e::SNAPSHOT) {
+            net::snapshot_t snapshot;
+            bool ok = net::read_snapshot(r, snapshot, [this](uint32_t tick) -> const net::snapshot_t * {
+                for (const auto &s : _snapshots)
+                    if (s.tick == tick) return &s;
+                return nullptr;
+            });
+            // late and reordered snapshots are useless for prediction
+            if (!ok || (!_snapshots.empty() && (snapshot.tick <= _snapshots.back().tick))) continue;
+            _snapshots.push_back(snapshot);
+            if (_snapshots.size() > snapshot_history_size) _snapshots.pop_front();
+            reconcile(snapshot);
+        }
+    }
+}
+
+world_snapshot_t client_c::step(const input_state_t &input) {
+    auto now = std::chrono::steady_clock::now();
+    if (!_joined && (now - _last_join > join_retry)) {
+        net::byte_writer_t w;
+        w.u8((uint8_t)net::packet_type_e::JOIN);
+        w.varint(_room);
+        _socket.send(_server, w.data);
+        _last_join = now;
+    }
+    receive();
+
+    world_snapshot_t ret;
+    if (!_joined) return ret;
+
+    // predict with what the server will get, not with the exact input
+    input_state_t sent_input = {{quantize_input(input.p[0]) / 127.0, quantize_input(input.p[1]) / 127.0}};
+    _pending.push_back({++_input_seq, sent_input});
+    if (_pending.size() > snapshot_history_size*2) _pending.pop_front();
+    predict(sent_input);
+
+    net::byte_writer_t w;
+    w.u8((uint8_t)net::packet_type_e::INPUT);
+    w.varint(_room);
+    w.varint(_snapshots.empty() ? 0 : _snapshots.back().tick);
+    w.varint(_input_seq);
+    size_t count = std::min(_pending.size(), input_redundancy);
+    w.varint(count);
+    for (size_t i = 0; i < count; i++) {
+        const auto &pending_input = _pending[_pending.size() - 1 - i].second;
+        w.i8(quantize_input(pending_input.p[0]));
+        w.i8(quantize_input(pending_input.p[1]));
+    }
+    _socket.send(_server, w.data);
+
+    if (_snapshots.empty()) {
+        ret.cars.push_back(_predicted.state());
+        return ret;
+    }
+    const auto &last = _snapshots.back();
+    ret.tick = last.tick;
+    for (const auto &car : last.cars) ret.cars.push_back(net::dequantize(car));
+    if (last.your_car < ret.cars.size()) ret.cars[last.your_car] = _predicted.state();
+    return ret;
+}
+
+}
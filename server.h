@@ -0,0 +1,194 @@
+/*
+
+MIT License with AI exception
+
+Copyright (c) Tadeusz Puźniakowski 2024
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is furnished
+to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+Additional restriction:
+
+The Software may not be used, in whole or in part, to teach or train any
+artificial intelligence system, including but not limited to large language
+models (LLMs), neural networks, or any other type of AI technology. Violation of
+this restriction will be considered a breach of this License.
+
+*/
+
+
+
+#ifndef MCGGAME_SERVER_H
+#define MCGGAME_SERVER_H
+
+#include "game.h"
+#include "net.h"
+#include "world_state.h"
+
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <memory>
+#include <vector>
+
+namespace mcggame {
+
+/**
+ * @brief Input set from the network, or by the client when it replays its
+ * own inputs.
+ */
+class input_network_c : public input_i {
+public:
+    input_state_t state = {{0.0, 0.0}};
+
+    input_state_t get_state() const {
+        return state;
+    }
+};
+
+/**
+ * @brief Authoritative game server. Every room is an independent race on the
+ * same track; all rooms are stepped on the thread calling step().
+ *
+ * Clients send JOIN with a room number, then INPUT packets with their newest
+ * inputs and the tick of the last snapshot they got. The server applies one
+ * input per tick and every snapshot_interval ticks sends each client a
+ * snapshot delta compressed against the last snapshot that client acked.
+ * A client that stays silent is dropped; its car stays parked in the race
+ * until the next player joining the room takes its place.
+ */
+class server_c {
+public:
+    struct client_t {
+        net::address_t address;
+        uint32_t room;
+        size_t car;
+        std::shared_ptr<input_network_c> input;
+        std::map<uint32_t, input_state_t> inputs; ///< received, not applied yet
+        uint32_t input_ack = 0;                  ///< last applied input
+        uint32_t acked_tick = 0;                 ///< last snapshot the client got
+        std::chrono::steady_clock::time_point last_seen;
+    };
+
+    struct room_t {
+        uint32_t tick = 0;
+        std::vector<car_t> cars;
+        std::deque<net::snapshot_t> history; ///< baselines for the deltas
+    };
+
+    struct stats_t {
+        size_t rooms = 0;
+        size_t clients = 0;
+        uint64_t ticks = 0;
+        uint64_t packets_sent = 0;
+        uint64_t bytes_sent = 0;
+        double step_time = 0.0; ///< seconds spent in step(), summed
+        repair_stats_t repair;
+    };
+
+private:
+    net::udp_socket_c _socket;
+    std::shared_ptr<race_track_t> _race_track;
+    car_t _car_prototype;
+    double _dt;
+    simulation_params_t _params;
+    int _snapshot_interval;
+    size_t _max_players;
+    std::map<uint32_t, room_t> _rooms;
+    std::map<uint64_t, client_t> _clients;
+    stats_t _stats;
+
+    void receive();
+    void handle_join(const net::address_t &from, net::byte_reader_t &r);
+    void handle_input(const net::address_t &from, net::byte_reader_t &r);
+    void step_room(const uint32_t room_id, room_t &room);
+    void send(const net::address_t &to, const std::vector<uint8_t> &data);
+
+public:
+    /**
+     * @param car_prototype every joining player gets a copy of this car
+     */
+    server_c(const uint16_t port, std::shared_ptr<race_track_t> race_track, const car_t &car_prototype, const double dt, const int snapshot_interval = 2, const size_t max_players = 16);
+
+    /**
+     * @brief Receives the waiting packets, advances every room by one tick and sends the snapshots.
+     */
+    void step();
+
+    /**
+     * @brief Changes the simulation of every room from the next tick, and of
+     * the players that join later.
+     */
+    void set_simulation(const simulation_params_t &params, const car_physics_fn physics);
+
+    const stats_t &stats() const { return _stats; }
+};
+
+/**
+ * @brief Client of server_c with client side prediction.
+ *
+ * The own car is simulated locally with every input as soon as it is made.
+ * When a snapshot arrives, the own car is reset to the authoritative state
+ * and the inputs the server has not applied yet are replayed on top of it.
+ */
+class client_c {
+    net::udp_socket_c _socket;
+    net::address_t _server;
+    uint32_t _room;
+    std::shared_ptr<race_track_t> _race_track;
+    double _dt;
+    simulation_params_t _params;
+
+    bool _joined = false;
+    std::chrono::steady_clock::time_point _last_join;
+    uint32_t _input_seq = 0;
+    std::deque<std::pair<uint32_t, input_state_t>> _pending; ///< sent, not applied by the server yet
+    std::deque<net::snapshot_t> _snapshots;                  ///< received, baselines for the deltas
+
+    std::shared_ptr<input_network_c> _input;
+    car_t _predicted;
+
+    void receive();
+    void reconcile(const net::snapshot_t &snapshot);
+    void predict(const input_state_t &input);
+
+public:
+    /**
+     * @param car prototype of the own car, its input is replaced
+     * @param params simulation of the prediction, the same as on the server
+     */
+    client_c(const net::address_t &server, const uint32_t room, std::shared_ptr<race_track_t> race_track, const car_t &car, const double dt, const simulation_params_t &params = {});
+
+    /**
+     * @brief Sends the input for the next tick and returns the world as the
+     * client sees it: other cars from the last snapshot, own car predicted.
+     */
+    world_snapshot_t step(const input_state_t &input);
+
+    /**
+     * @brief Changes the simulation of the prediction from the next step.
+     */
+    void set_simulation(const simulation_params_t &params, const car_physics_fn physics);
+
+    bool joined() const { return _joined; }
+};
+
+}
+
+#endif
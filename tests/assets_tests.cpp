@@ -0,0 +1,126 @@
+/*
+
+MIT License with AI exception
+
+Copyright (c) Tadeusz Puźniakowski 2024
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is furnished
+to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+Additional restriction:
+
+The Software may not be used, in whole or in part, to teach or train any
+artificial intelligence system, including but not limited to large language
+models (LLMs), neural networks, or any other type of AI technology. Violation of
+this restriction will be considered a breach of this License.
+
+*/
+
+
+
+#include "property.h"
+#include "../assets.h"
+
+#include <algorithm>
+#include <filesystem>
+
+namespace mcggame {
+namespace test {
+
+// the tests run in the source directory, see CMakeLists.txt
+static const std::string car_file = "assets/car_01.bmp";
+
+/**
+ * @brief Writes a race track bitmap into directory: road with random wall
+ * blocks, in the colors track_asset_t::decode reads.
+ *
+ * @param expected receives the collision map the file should decode to
+ */
+static std::string write_track(std::mt19937 &rng, const std::filesystem::path &directory, logic_bitmap_t &expected) {
+    const Uint32 road = 0xff00ffffu, wall = 0xff000000u;
+    const int w = uniform_int(rng, 64, 256), h = uniform_int(rng, 64, 256);
+    auto surface = std::shared_ptr<SDL_Surface>(SDL_CreateRGBSurfaceWithFormat(0, w, h, 32, SDL_PIXELFORMAT_ARGB8888), [](auto p){SDL_FreeSurface(p);});
+    if (!surface) throw std::runtime_error(SDL_GetError());
+    SDL_FillRect(surface.get(), nullptr, road);
+    expected = {w, h, std::vector<unsigned char>(w*h, 0)};
+    for (int i = uniform_int(rng, 1, 8); i > 0; i--) {
+        SDL_Rect rect = {uniform_int(rng, 0, w - 1), uniform_int(rng, 0, h - 1), uniform_int(rng, 1, 40), uniform_int(rng, 1, 40)};
+        SDL_FillRect(surface.get(), &rect, wall);
+        for (int y = rect.y; y < std::min(h, rect.y + rect.h); y++)
+            for (int x = rect.x; x < std::min(w, rect.x + rect.w); x++) expected(x, y) = 255;
+    }
+    auto fname = (directory / "track.bmp").string();
+    if (SDL_SaveBMP(surface.get(), fname.c_str()) != 0) throw std::runtime_error(SDL_GetError());
+    return fname;
+}
+
+static std::filesystem::path temp_directory(std::mt19937 &rng) {
+    auto directory = std::filesystem::temp_directory_path() / ("mcggame_assets_" + std::to_string(rng()));
+    std::filesystem::create_directories(directory);
+    return directory;
+}
+
+static test_registration_t assets_match_synchronous_decode("assets/tracks decoded by the workers are the same as decoded directly", [](std::mt19937 &rng) {
+    auto directory = temp_directory(rng);
+    logic_bitmap_t drawn;
+    auto track_file = write_track(rng, directory, drawn);
+    asset_manager_c assets(2);
+    auto track = assets.load_track(track_file, true).get();
+    auto expected = track_asset_t::decode(track_file, true);
+    check((track->collision_map.w == expected.collision_map.w) && (track->collision_map.h == expected.collision_map.h), "different size");
+    check(track->collision_map.bitmap == expected.collision_map.bitmap, "different collision map");
+    check(track->wall_shapes && (track->wall_shapes->segment_count() == expected.wall_shapes->segment_count()), "different walls");
+    check(!assets.load_track(track_file, false).get()->wall_shapes, "walls vectorized without asking");
+    check(expected.collision_map.bitmap == drawn.bitmap, "the collision map is not the drawn walls");
+    std::filesystem::remove_all(directory);
+});
+
+static test_registration_t assets_load_once("assets/every file is decoded once and progress counts it", [](std::mt19937 &rng) {
+    auto directory = temp_directory(rng);
+    logic_bitmap_t drawn;
+    auto track_file = write_track(rng, directory, drawn);
+    asset_manager_c assets(uniform_int(rng, 1, 4));
+    std::vector<asset_future_t<sprite_asset_t>> sprites;
+    for (int i = 0; i < 10; i++) sprites.push_back(assets.load_sprite(car_file));
+    auto track = assets.load_track(track_file);
+    for (auto &s : sprites) check(s.get() == sprites[0].get(), "the sprite was decoded twice");
+    track.get();
+    check(is_ready(track) && is_ready(sprites[0]), "not ready after get()");
+    // the counter is updated just before the future is ready
+    while (!assets.progress().done()) std::this_thread::yield();
+    check(assets.progress().requested == 2, "wrong number of requests");
+    check(assets.progress().fraction() == 1.0, "not finished");
+    std::filesystem::remove_all(directory);
+});
+
+static test_registration_t assets_errors("assets/errors are thrown from the future", [](std::mt19937 &rng) {
+    // a directory that is never created, so the file cannot exist
+    auto missing = std::filesystem::temp_directory_path() / ("mcggame_missing_" + std::to_string(rng())) / "track.bmp";
+    asset_manager_c assets(1);
+    auto track = assets.load_track(missing.string());
+    bool thrown = false;
+    try {
+        track.get();
+    } catch (const std::runtime_error &) {
+        thrown = true;
+    }
+    check(thrown, "no exception for a missing file");
+});
+
+}
+}
@@ -0,0 +1,220 @@
+/*
+
+MIT License with AI exception
+
+Copyright (c) Tadeusz Puźniakowski 2024
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is furnished
+to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+Additional restriction:
+
+The Software may not be used, in whole or in part, to teach or train any
+artificial intelligence system, including but not limited to large language
+models (LLMs), neural networks, or any other type of AI technology. Violation of
+this restriction will be considered a breach of this License.
+
+*/
+
+
+
+#include "property.h"
+#include "../collision_shapes.h"
+#include "../game.h"
+
+#include <algorithm>
+
+namespace mcggame {
+namespace test {
+
+/**
+ * @brief Road with random rectangular and round walls, 255 is a wall.
+ */
+static logic_bitmap_t random_track(std::mt19937 &rng, const int w = 256, const int h = 256) {
+    logic_bitmap_t map;
+    map.w = w;
+    map.h = h;
+    map.bitmap.assign(w*h, 0);
+    int obstacles = uniform_int(rng, 1, 12);
+    for (int i = 0; i < obstacles; i++) {
+        int cx = uniform_int(rng, 0, w - 1);
+        int cy = uniform_int(rng, 0, h - 1);
+        int rx = uniform_int(rng, 2, 40);
+        int ry = uniform_int(rng, 2, 40);
+        bool round = uniform_int(rng, 0, 1);
+        for (int y = cy - ry; y <= cy + ry; y++)
+            for (int x = cx - rx; x <= cx + rx; x++) {
+                double dx = (x - cx)/(double)rx;
+                double dy = (y - cy)/(double)ry;
+                if (!round || (dx*dx + dy*dy <= 1.0)) map(x, y) = 255;
+            }
+    }
+    return map;
+}
+
+static oriented_box_t random_box(std::mt19937 &rng, const logic_bitmap_t &map) {
+    return {{uniform(rng, 60.0, map.w - 60.0), uniform(rng, 60.0, map.h - 60.0)},
+            {uniform(rng, 5.0, 40.0), uniform(rng, 5.0, 20.0)},
+            uniform(rng, -M_PI, M_PI)};
+}
+
+/**
+ * @brief The pixel collision test with collision points every half pixel
+ * over the box grown by margin on every side.
+ */
+static bool pixels_collide(const oriented_box_t &box, const double margin, const logic_bitmap_t &map) {
+    std::vector<position_t> points;
+    for (double x = -box.half_size[0] - margin; x <= box.half_size[0] + margin; x += 0.5)
+        for (double y = -box.half_size[1] - margin; y <= box.half_size[1] + margin; y += 0.5)
+            points.push_back({x, y});
+    return check_collision(points, box.center, box.angle, map).size() > 0;
+}
+
+static test_registration_t sat_agrees_with_pixels("collision/SAT agrees with the pixel test up to 2 pixels", [](std::mt19937 &rng) {
+    for (int t = 0; t < 20; t++) {
+        auto map = random_track(rng);
+        wall_shapes_c shapes(map);
+        for_all(rng, 100, [&](std::mt19937 &rng) { return random_box(rng, map); },
+            [&](const oriented_box_t &box) {
+            bool sat = shapes.check_collision(box, map).size() > 0;
+            if (sat) check(pixels_collide(box, 2.0, map), "SAT collision far from any wall pixel");
+            else check(!pixels_collide(box, -2.0, map), "wall pixels deep inside the box but no SAT collision");
+        });
+    }
+});
+
+static test_registration_t sat_contacts_inside_box("collision/SAT contact points are inside the box", [](std::mt19937 &rng) {
+    auto map = random_track(rng);
+    wall_shapes_c shapes(map);
+    for_all(rng, 2000, [&](std::mt19937 &rng) { return random_box(rng, map); },
+        [&](const oriented_box_t &box) {
+        for (const auto &p : shapes.check_collision(box, map)) {
+            auto local = rotate_around(p - box.center, -box.angle);
+            check(std::abs(local[0]) <= box.half_size[0] + 1e-6, "contact outside the box along x");
+            check(std::abs(local[1]) <= box.half_size[1] + 1e-6, "contact outside the box along y");
+        }
+    });
+});
+
+static test_registration_t sat_penetration_depth("collision/SAT penetration is the depth of the box behind a straight wall", [](std::mt19937 &rng) {
+    logic_bitmap_t map;
+    map.w = map.h = 256;
+    map.bitmap.assign(256*256, 0);
+    const int wall_x = 128;
+    for (int y = 0; y < 256; y++)
+        for (int x = wall_x; x < 256; x++) map(x, y) = 255;
+    wall_shapes_c shapes(map);
+    for_all(rng, 500, [&](std::mt19937 &rng) {
+        position_t half_size = {uniform(rng, 5.0, 40.0), uniform(rng, 5.0, 20.0)};
+        // the box stays inside one tile along y, and can have its center in the wall
+        double depth = uniform(rng, 0.5, 2.0*std::min(half_size[0], half_size[1]) - 0.5);
+        return std::make_pair(oriented_box_t{{wall_x + depth - half_size[0], uniform(rng, 88.0, 104.0)}, half_size, 0.0}, depth);
+    }, [&](const std::pair<oriented_box_t, double> &c) {
+        auto [box, depth] = c;
+        std::vector<double> depths;
+        auto contacts = shapes.check_collision(box, map, &depths);
+        check(!contacts.empty(), "no collision");
+        check(depths.size() == contacts.size(), "not one depth per contact");
+        check_near(*std::max_element(depths.begin(), depths.end()), depth, 1e-6, "penetration depth");
+    });
+});
+
+static test_registration_t rebuild_region_matches_full_rebuild("collision/rebuild_region gives the same walls as vectorizing from scratch", [](std::mt19937 &rng) {
+    auto map = random_track(rng);
+    wall_shapes_c shapes(map);
+    for_all(rng, 50, [&](std::mt19937 &rng) {
+        return track_edit_t{{uniform(rng, 0.0, map.w), uniform(rng, 0.0, map.h)}, uniform(rng, 2.0, 20.0), (bool)uniform_int(rng, 0, 1)};
+    }, [&](const track_edit_t &edit) {
+        int x0 = (int)std::floor(edit.center[0] - edit.radius), x1 = (int)std::ceil(edit.center[0] + edit.radius) + 1;
+        int y0 = (int)std::floor(edit.center[1] - edit.radius), y1 = (int)std::ceil(edit.center[1] + edit.radius) + 1;
+        for (int y = y0; y < y1; y++)
+            for (int x = x0; x < x1; x++)
+                if (~(position_t{x + 0.5, y + 0.5} - edit.center) <= edit.radius) map(x, y) = edit.wall ? 255 : 0;
+        shapes.rebuild_region(map, x0, y0, x1, y1);
+
+        wall_shapes_c expected(map);
+        for (int ty = 0; ty < expected.tiles_h(); ty++)
+            for (int tx = 0; tx < expected.tiles_w(); tx++) {
+                const auto &a = shapes.tile(tx, ty).segments;
+                const auto &b = expected.tile(tx, ty).segments;
+                check(a.size() == b.size(), "different number of segments in a tile");
+                for (size_t i = 0; i < a.size(); i++)
+                    check((a[i].a == b[i].a) && (a[i].b == b[i].b), "different segments in a tile");
+            }
+    });
+});
+
+static double distance_to_segment(const position_t &p, const position_t &a, const position_t &b) {
+    auto ab = b - a;
+    double l2 = ab[0]*ab[0] + ab[1]*ab[1];
+    double t = (l2 > 0.0) ? ((p[0] - a[0])*ab[0] + (p[1] - a[1])*ab[1])/l2 : 0.0;
+    t = std::max(0.0, std::min(1.0, t));
+    return ~(a + ab*t - p);
+}
+
+static test_registration_t simplify_polyline_within_epsilon("collision/simplify_polyline stays within epsilon", [](std::mt19937 &rng) {
+    for_all(rng, 1000, [](std::mt19937 &rng) {
+        std::vector<position_t> polyline = {{0.0, 0.0}};
+        int n = uniform_int(rng, 1, 200);
+        for (int i = 0; i < n; i++)
+            polyline.push_back(polyline.back() + position_t{uniform(rng, -5.0, 5.0), uniform(rng, -5.0, 5.0)});
+        return std::make_pair(polyline, uniform(rng, 0.1, 3.0));
+    }, [](const auto &c) {
+        const auto &[polyline, epsilon] = c;
+        auto simplified = simplify_polyline(polyline, epsilon);
+        check(simplified.front() == polyline.front(), "first point moved");
+        check(simplified.back() == polyline.back(), "last point moved");
+        check(simplified.size() <= polyline.size(), "more points than before");
+        for (const auto &p : polyline) {
+            double d = 1e9;
+            for (size_t i = 0; i + 1 < simplified.size(); i++)
+                d = std::min(d, distance_to_segment(p, simplified[i], simplified[i + 1]));
+            check(d <= epsilon + 1e-9, "point further than epsilon from the simplified polyline");
+        }
+    });
+});
+
+static test_registration_t cache_matches_check_collision("collision/the collision cache gives the same points as check_collision, also after edits", [](std::mt19937 &rng) {
+    track_asset_t asset;
+    asset.collision_map = random_track(rng);
+    race_track_t race_track(asset, nullptr);
+    auto car = car_t::create(nullptr, nullptr);
+    collision_cache_c cache;
+    // a car wandering around, with jumps and track edits now and then
+    position_t p = {uniform(rng, 0.0, 256.0), uniform(rng, 0.0, 256.0)};
+    double angle = uniform(rng, -M_PI, M_PI);
+    for (int i = 0; i < 2000; i++) {
+        switch (uniform_int(rng, 0, 40)) {
+            case 0:
+                p = {uniform(rng, 0.0, 256.0), uniform(rng, 0.0, 256.0)};
+                break;
+            case 1:
+                race_track.apply_edit({{uniform(rng, 0.0, 256.0), uniform(rng, 0.0, 256.0)}, uniform(rng, 2.0, 30.0), (bool)uniform_int(rng, 0, 1)});
+                break;
+            default:
+                p = p + position_t{uniform(rng, -1.5, 1.5), uniform(rng, -1.5, 1.5)};
+                angle += uniform(rng, -0.05, 0.05);
+        }
+        auto expected = check_collision(*car.collision_pts, p, angle, race_track._collision_map);
+        check(cache.check_collision(*car.collision_pts, p, angle, race_track) == expected, "different collision points at step " + std::to_string(i));
+    }
+    check(cache.stats().probes_saved > 0, "no probe was saved");
+});
+
+}
+}
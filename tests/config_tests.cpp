@@ -0,0 +1,152 @@
+/*
+
+MIT License with AI exception
+
+Copyright (c) Tadeusz Puźniakowski 2024
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is furnished
+to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+Additional restriction:
+
+The Software may not be used, in whole or in part, to teach or train any
+artificial intelligence system, including but not limited to large language
+models (LLMs), neural networks, or any other type of AI technology. Violation of
+this restriction will be considered a breach of this License.
+
+*/
+
+
+#include "property.h"
+#include "../config.h"
+
+#include <fstream>
+#include <sstream>
+#include <thread>
+#include <utility>
+
+#ifdef __linux__
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace mcggame {
+namespace test {
+
+static bool throws_invalid_argument(const std::function<void()> &f) {
+    try {
+        f();
+    } catch (const std::invalid_argument &) {
+        return true;
+    }
+    return false;
+}
+
+static test_registration_t config_file_values("config/the file sets the options and the arguments win", [](std::mt19937 &rng) {
+    auto path = std::filesystem::temp_directory_path() / ("mcggame_" + std::to_string(rng()) + ".conf");
+    const int substeps = uniform_int(rng, 1, 8);
+    const double friction = uniform(rng, 0.0, 2.0);
+    {
+        std::ofstream file(path);
+        file << "# tuning\n"
+             << "substeps = " << substeps << "\n"
+             << "  extra-friction=" << friction << "   # drag\n"
+             << "\n"
+             << "physics = drift\n"
+             << "spawn = 10,20; 30.5,40\n"
+             << "repair-iterations = 50\n";
+    }
+    auto config = load_config({"--config=" + path.string(), "--repair-iterations=7", "--track=other.bmp"});
+    std::filesystem::remove(path);
+
+    check(config.simulation.substeps == substeps, "substeps not read");
+    check_near(config.simulation.extra_friction, friction, 1e-4, "extra friction not read");
+    check(config.physics == physics_model_from_string("drift"), "physics not read");
+    check((config.spawn.size() == 2) && (config.spawn[1][0] == 30.5) && (config.spawn[1][1] == 40.0), "spawn not read");
+    check(config.simulation.repair_iterations == 7, "the argument does not override the file");
+    check(config.track == "other.bmp", "track not set by the argument");
+    check(config.dt == game_config_t().dt, "dt changed without being set");
+});
+
+static test_registration_t config_errors("config/mistakes are reported with the line", [](std::mt19937 &) {
+    game_config_t config;
+    std::string message;
+    try {
+        std::istringstream in("dt = 0.01\nsubsteps = many\n");
+        read_config(config, in, "test.conf");
+    } catch (const std::invalid_argument &e) {
+        message = e.what();
+    }
+    check(message.rfind("test.conf:2:", 0) == 0, "no line in \"" + message + "\"");
+    check(throws_invalid_argument([&]() { config.set("no-such-option", "1"); }), "unknown option accepted");
+    check(throws_invalid_argument([&]() { config.set("dt", "0"); }), "zero dt accepted");
+    check(throws_invalid_argument([&]() { config.set("spawn", "1;2"); }), "spawn without y accepted");
+    for (const auto &[key, value] : std::vector<std::pair<std::string, std::string>>{
+            {"export-fps", "0"}, {"export-frames", "0"}, {"export-size", "0x480"}, {"export-size", "640x-1"},
+            {"views", "-2"}, {"sprite-cache", "-1"}, {"repair-budget", "-1"}, {"repair-time-budget", "-5"},
+            {"repair-iterations", "-1"}, {"repair-position-step", "0"}, {"repair-angle-step", "-0.1"},
+            {"extra-friction", "-1"}, {"snapshot-interval", "0"}, {"server", "70000"}, {"substeps", "0"}})
+        check(throws_invalid_argument([&]() { config.set(key, value); }), key + " = " + value + " accepted");
+    check(config.export_fps == game_config_t().export_fps, "a rejected value was kept");
+    config.set("repair-budget", "0");
+    config.set("views", "auto");
+    check(throws_invalid_argument([&]() { load_config({"--config=/nonexistent/mcggame.conf"}); }), "missing config file accepted");
+    check(throws_invalid_argument([&]() { load_config({"positional"}); }), "argument without -- accepted");
+});
+
+static test_registration_t config_watcher_notices("config/the watcher notices writes and replacements of the file", [](std::mt19937 &rng) {
+    auto directory = std::filesystem::temp_directory_path() / ("mcggame_config_" + std::to_string(rng()));
+    std::filesystem::create_directories(directory);
+    auto path = directory / "mcggame.conf";
+    std::ofstream(path) << "substeps = 1\n";
+
+    config_watcher_c watcher(path.string());
+    check(!watcher.changed(), "changed before any write");
+    // the modification time may have a coarse resolution where there is no inotify
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    std::ofstream(path) << "substeps = 2\n";
+    check(watcher.changed(), "write not noticed");
+    check(!watcher.changed(), "one write reported twice");
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    std::ofstream(directory / "mcggame.conf.new") << "substeps = 3\n";
+    std::filesystem::rename(directory / "mcggame.conf.new", path);
+    check(watcher.changed(), "replacement not noticed");
+    std::filesystem::remove_all(directory);
+});
+
+#ifdef __linux__
+static test_registration_t config_watcher_waits_for_close("config/the watcher does not report a file that is still being written", [](std::mt19937 &rng) {
+    auto directory = std::filesystem::temp_directory_path() / ("mcggame_config_" + std::to_string(rng()));
+    std::filesystem::create_directories(directory);
+    auto path = directory / "mcggame.conf";
+
+    config_watcher_c watcher(path.string());
+    int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    check(!watcher.changed(), "reported when the file was created");
+    const std::string half = "substeps =";
+    check(write(fd, half.data(), half.size()) == (ssize_t)half.size(), "could not write");
+    check(!watcher.changed(), "reported while the file is written");
+    close(fd);
+    check(watcher.changed(), "not reported when the file was closed");
+    std::filesystem::remove_all(directory);
+});
+#endif
+
+}
+}
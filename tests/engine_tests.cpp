@@ -0,0 +1,146 @@
+/*
+
+MIT License with AI exception
+
+Copyright (c) Tadeusz Puźniakowski 2024
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is furnished
+to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+Additional restriction:
+
+The Software may not be used, in whole or in part, to teach or train any
+artificial intelligence system, including but not limited to large language
+models (LLMs), neural networks, or any other type of AI technology. Violation of
+this restriction will be considered a breach of this License.
+
+*/
+
+
+
+#include "property.h"
+#include "../engine.h"
+
+namespace mcggame {
+namespace test {
+
+static position_t random_position(std::mt19937 &rng, const double range = 1000.0) {
+    return {uniform(rng, -range, range), uniform(rng, -range, range)};
+}
+
+static test_registration_t rotate_around_preserves_length("engine/rotate_around preserves distance to the pivot", [](std::mt19937 &rng) {
+    for_all(rng, 10000, [](std::mt19937 &rng) {
+        return std::make_tuple(random_position(rng), uniform(rng, -10.0, 10.0), random_position(rng));
+    }, [](const auto &c) {
+        auto [p, angle, d] = c;
+        check_near(~(rotate_around(p, angle, d) - d), ~(p - d), 1e-9, "distance to the pivot");
+    });
+});
+
+static test_registration_t rotate_around_inverts("engine/rotate_around by -angle inverts rotation by angle", [](std::mt19937 &rng) {
+    for_all(rng, 10000, [](std::mt19937 &rng) {
+        return std::make_tuple(random_position(rng), uniform(rng, -10.0, 10.0), random_position(rng));
+    }, [](const auto &c) {
+        auto [p, angle, d] = c;
+        auto q = rotate_around(rotate_around(p, angle, d), -angle, d);
+        check_near(q[0], p[0], 1e-9, "x");
+        check_near(q[1], p[1], 1e-9, "y");
+    });
+});
+
+static test_registration_t rotate_around_composes("engine/rotate_around composes by adding angles", [](std::mt19937 &rng) {
+    for_all(rng, 10000, [](std::mt19937 &rng) {
+        return std::make_tuple(random_position(rng), uniform(rng, -M_PI, M_PI), uniform(rng, -M_PI, M_PI));
+    }, [](const auto &c) {
+        auto [p, a, b] = c;
+        auto q1 = rotate_around(rotate_around(p, a), b);
+        auto q2 = rotate_around(p, a + b);
+        check_near(q1[0], q2[0], 1e-9, "x");
+        check_near(q1[1], q2[1], 1e-9, "y");
+    });
+});
+
+static test_registration_t angle_crop_range("engine/angle_crop_to_range is in [-pi,pi) and keeps the direction", [](std::mt19937 &rng) {
+    for_all(rng, 100000, [](std::mt19937 &rng) {
+        double range = std::pow(10.0, uniform(rng, -3.0, 5.0));
+        return uniform(rng, -range, range);
+    }, [](const double a) {
+        double c = angle_crop_to_range(a);
+        check((c >= -M_PI) && (c < M_PI), "result out of range for " + std::to_string(a));
+        // the same direction: the difference is a whole number of turns
+        double turns = (a - c)/(2.0*M_PI);
+        check_near(turns, std::round(turns), 1e-9*(1.0 + std::abs(a)), "whole turns");
+        check(angle_crop_to_range(c) == c, "cropping again changes the angle");
+    });
+});
+
+static test_registration_t angle_crop_edges("engine/angle_crop_to_range edge cases", [](std::mt19937 &) {
+    check(angle_crop_to_range(M_PI) == -M_PI, "pi");
+    check(angle_crop_to_range(-M_PI) == -M_PI, "-pi");
+    check(angle_crop_to_range(0.0) == 0.0, "0");
+    check_near(angle_crop_to_range(5.0*M_PI + 0.5), -M_PI + 0.5, 1e-12, "5 pi + 0.5");
+    check_near(angle_crop_to_range(-7.0*M_PI + 0.5), -M_PI + 0.5, 1e-12, "-7 pi + 0.5");
+    check_near(angle_crop_to_range(1e6), std::remainder(1e6, 2.0*M_PI), 1e-9, "1e6");
+});
+
+static test_registration_t angle_between_vectors_rotation("engine/angle_between_vectors finds the rotation", [](std::mt19937 &rng) {
+    for_all(rng, 10000, [](std::mt19937 &rng) {
+        position_t v = random_position(rng);
+        if (~v < 1e-3) v = {1.0, 0.0};
+        return std::make_pair(v, uniform(rng, -20.0, 20.0));
+    }, [](const auto &c) {
+        auto [v, angle] = c;
+        double expected = angle_crop_to_range(angle);
+        double a = angle_between_vectors(v, rotate_around(v, angle));
+        // near +-pi both ends of the range are the same rotation
+        check_near(angle_crop_to_range(a - expected), 0.0, 1e-9, "rotation");
+    });
+});
+
+static test_registration_t angle_between_shapes_rotation("engine/angle_between_shapes finds the rotation of a rotated shape", [](std::mt19937 &rng) {
+    for_all(rng, 2000, [](std::mt19937 &rng) {
+        std::vector<position_t> shape;
+        int n = uniform_int(rng, 3, 12);
+        for (int i = 0; i < n; i++) {
+            // star shaped polygon, so no edge has zero length
+            double a = 2.0*M_PI*i/n;
+            double r = uniform(rng, 10.0, 50.0);
+            shape.push_back({r*std::cos(a), r*std::sin(a)});
+        }
+        return std::make_pair(shape, uniform(rng, -M_PI*0.99, M_PI*0.99));
+    }, [](const auto &c) {
+        auto [shape, angle] = c;
+        auto rotated = shape;
+        for (auto &p : rotated) p = rotate_around(p, angle);
+        check_near(angle_between_shapes(shape, rotated), angle, 1e-9, "rotation");
+        check_near(angle_between_shapes(shape, shape), 0.0, 1e-12, "no rotation");
+    });
+});
+
+static test_registration_t angle_between_shapes_sizes("engine/angle_between_shapes rejects shapes of different sizes", [](std::mt19937 &) {
+    bool thrown = false;
+    try {
+        angle_between_shapes({{0.0, 0.0}, {1.0, 0.0}}, {{0.0, 0.0}});
+    } catch (const std::invalid_argument &) {
+        thrown = true;
+    }
+    check(thrown, "no exception");
+});
+
+}
+}
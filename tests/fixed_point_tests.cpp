@@ -0,0 +1,236 @@
+/*
+
+MIT License with AI exception
+
+Copyright (c) Tadeusz Puźniakowski 2024
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is furnished
+to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+Additional restriction:
+
+The Software may not be used, in whole or in part, to teach or train any
+artificial intelligence system, including but not limited to large language
+models (LLMs), neural networks, or any other type of AI technology. Violation of
+this restriction will be considered a breach of this License.
+
+*/
+
+
+
+#include "property.h"
+#include "../fixed_point.h"
+#include "../physics.h"
+#include "../game.h"
+
+#include <cstring>
+
+namespace mcggame {
+namespace test {
+
+using namespace mcggame::fixed;
+
+static fixed_t random_fixed(std::mt19937 &rng, const double range) {
+    return fixed_t::from_double(uniform(rng, -range, range));
+}
+
+static test_registration_t fixed_arithmetic("fixed/multiplication and division are within one unit of exact", [](std::mt19937 &rng) {
+    for_all(rng, 100000, [](std::mt19937 &rng) {
+        return std::make_pair(random_fixed(rng, 1e4), random_fixed(rng, 1e2));
+    }, [](const auto &c) {
+        auto [a, b] = c;
+        const double unit = 1.0/fixed_t::one_raw;
+        check_near((a*b).to_double(), a.to_double()*b.to_double(), unit + 1e-16*std::abs(a.to_double()*b.to_double()), "product");
+        if (b.raw != 0) check_near((a/b).to_double(), a.to_double()/b.to_double(), unit + 1e-15*std::abs(a.to_double()/b.to_double()), "quotient");
+        check(fixed_t::from_double(a.to_double()) == a, "double round trip");
+    });
+});
+
+static test_registration_t fixed_sqrt("fixed/sqrt rounds down", [](std::mt19937 &rng) {
+    for_all(rng, 100000, [](std::mt19937 &rng) {
+        return fixed_t::from_raw((int64_t)(((uint64_t)rng() << 31) ^ rng()) >> uniform_int(rng, 0, 40));
+    }, [](const fixed_t v) {
+        if (v.raw < 0) {
+            check(sqrt(v).raw == 0, "sqrt of a negative number");
+            return;
+        }
+        unsigned __int128 n = (unsigned __int128)v.raw << fixed_t::fraction_bits;
+        unsigned __int128 r = (uint64_t)sqrt(v).raw;
+        check((r*r <= n) && ((r + 1)*(r + 1) > n), "not the integer square root");
+    });
+});
+
+static test_registration_t fixed_trigonometry("fixed/sin and cos are close to libm", [](std::mt19937 &rng) {
+    for_all(rng, 100000, [](std::mt19937 &rng) { return (angle_t)rng(); }, [](const angle_t a) {
+        double r = angle_to_radians(a);
+        check_near(sin(a).to_double(), std::sin(r), 1e-6, "sin");
+        check_near(cos(a).to_double(), std::cos(r), 1e-6, "cos");
+    });
+    check(sin(0).raw == 0, "sin(0)");
+    check(cos(0).raw == fixed_t::one_raw, "cos(0)");
+    check(sin(quarter_turn).raw == fixed_t::one_raw, "sin of the quarter turn");
+});
+
+static test_registration_t fixed_atan2("fixed/atan2 is close to libm", [](std::mt19937 &rng) {
+    for_all(rng, 100000, [](std::mt19937 &rng) {
+        double range = std::pow(10.0, uniform(rng, -4.0, 5.0));
+        return std::make_pair(random_fixed(rng, range), random_fixed(rng, range));
+    }, [](const auto &c) {
+        auto [y, x] = c;
+        if ((x.raw == 0) && (y.raw == 0)) return;
+        double expected = std::atan2((double)y.raw, (double)x.raw);
+        double difference = angle_to_radians(atan2(y, x) - angle_from_radians(expected));
+        // the vectors have only 32 fraction bits, so short ones have uncertain directions
+        double tolerance = 5e-8 + 2.0/std::max(std::abs((double)x.raw), std::abs((double)y.raw));
+        check_near(difference, 0.0, tolerance, "direction");
+    });
+});
+
+static test_registration_t fixed_angles("fixed/binary angles convert to radians and back", [](std::mt19937 &rng) {
+    for_all(rng, 100000, [](std::mt19937 &rng) { return (angle_t)rng(); }, [](const angle_t a) {
+        double r = angle_to_radians(a);
+        check((r >= -M_PI) && (r < M_PI), "out of range");
+        check(angle_from_radians(r) == a, "round trip");
+    });
+});
+
+static uint64_t hash_state(uint64_t hash, const car_state_t &s) {
+    // FNV-1a over the bits of the state
+    const double values[7] = {s.p[0], s.p[1], s.v[0], s.v[1], s.a[0], s.a[1], s.angle};
+    unsigned char bytes[sizeof(values)];
+    std::memcpy(bytes, values, sizeof(values));
+    for (auto b : bytes) {
+        hash ^= b;
+        hash *= 0x100000001b3ull;
+    }
+    return hash;
+}
+
+/**
+ * @brief Hash of a scripted drive, the same on every machine.
+ */
+static uint64_t scripted_drive(const car_physics_fn step) {
+    car_state_t s = {{100.0, 100.0}, {0.0, 0.0}, {0.0, 0.0}, 0.0};
+    uint64_t hash = 0xcbf29ce484222325ull;
+    for (int i = 0; i < 20000; i++) {
+        // full throttle with turns, braking and reversing
+        input_state_t input = {{(double)((i / 300) % 3) - 1.0, ((i / 1000) % 4 == 3) ? -1.0 : 1.0}};
+        s = step(s, input, 0.01);
+        hash = hash_state(hash, s);
+    }
+    return hash;
+}
+
+static test_registration_t fixed_physics_golden("fixed/fixed point physics gives the recorded trajectory", [](std::mt19937 &) {
+    check(scripted_drive(physics_model_from_string("arcade-fixed")) == 0xe2c2174e3527ebb4ull, "arcade-fixed trajectory changed");
+    check(scripted_drive(physics_model_from_string("drift-fixed")) == 0x536e5af9b1ee19f1ull, "drift-fixed trajectory changed");
+});
+
+struct scripted_input_c : public input_i {
+    input_state_t state = {{0.0, 0.0}};
+    input_state_t get_state() const { return state; }
+};
+
+/**
+ * @brief Hash of a scripted drive in a walled arena with a pillar, in the
+ * fixed collision mode, so the collision repair is part of the trajectory.
+ */
+static uint64_t scripted_drive_into_walls(const car_physics_fn physics, repair_stats_t &stats) {
+    track_asset_t asset;
+    asset.collision_map.w = 320;
+    asset.collision_map.h = 240;
+    asset.collision_map.bitmap.assign(320*240, 0);
+    for (int y = 0; y < 240; y++)
+        for (int x = 0; x < 320; x++)
+            if ((x < 16) || (x >= 304) || (y < 16) || (y >= 224) || ((std::abs(x - 160) < 24) && (std::abs(y - 120) < 24)))
+                asset.collision_map(x, y) = 255;
+    auto track = std::make_shared<race_track_t>(asset, nullptr);
+    track->set_collision_mode(collision_mode_e::FIXED);
+
+    auto input = std::make_shared<scripted_input_c>();
+    std::vector<car_t> cars = {car_t::create(nullptr, input, {80.0, 120.0}, {0.0, 0.0}, {0.0, 0.0}, "", physics)};
+    std::vector<position_t> collisions;
+    uint64_t hash = 0xcbf29ce484222325ull;
+    for (int i = 0; i < 3000; i++) {
+        input->state = {{(double)((i / 70) % 3) - 1.0, ((i / 500) % 4 == 3) ? -1.0 : 1.0}};
+        cars = simulation_step(cars, track, 0.01, collisions, simulation_params_t(), &stats);
+        hash = hash_state(hash, cars[0].state());
+    }
+    return hash;
+}
+
+static test_registration_t fixed_repair_golden("fixed/the collision repair in the fixed mode gives the recorded trajectory", [](std::mt19937 &) {
+    repair_stats_t arcade, drift;
+    uint64_t arcade_hash = scripted_drive_into_walls(physics_model_from_string("arcade-fixed"), arcade);
+    uint64_t drift_hash = scripted_drive_into_walls(physics_model_from_string("drift-fixed"), drift);
+    check(arcade.fixed > 0, "arcade-fixed did not hit a wall");
+    check(drift.fixed > 0, "drift-fixed did not hit a wall");
+    check(arcade_hash == 0xcfd3e288f752f6b4ull, "arcade-fixed trajectory into the walls changed");
+    check(drift_hash == 0x6ba45945387b4d53ull, "drift-fixed trajectory into the walls changed");
+});
+
+static test_registration_t fixed_physics_follows_arcade("fixed/fixed point physics stays close to the double model", [](std::mt19937 &rng) {
+    // the models switch between gripping and drifting, and between driving
+    // forward and backward, at slightly different moments, so the test stays
+    // below the drift speed and away from a sideways slide
+    for_all(rng, 1000, [](std::mt19937 &rng) {
+        double angle = uniform(rng, -M_PI, M_PI);
+        car_state_t s = {{uniform(rng, -2000.0, 2000.0), uniform(rng, -2000.0, 2000.0)},
+                         rotate_around({uniform(rng, 0.0, 50.0), 0.0}, angle + uniform(rng, -1.0, 1.0)),
+                         {0.0, 0.0},
+                         angle};
+        input_state_t input = {{(double)uniform_int(rng, -1, 1), (double)uniform_int(rng, -1, 1)}};
+        return std::make_pair(s, input);
+    }, [](const auto &c) {
+        auto [s, input] = c;
+        auto f = s;
+        for (int i = 0; i < 30; i++) {
+            s = arcade_physics::step(s, input, 0.01);
+            f = fixed_car_physics<arcade_constants>::step(f, input, 0.01);
+        }
+        check_near(f.p[0], s.p[0], 0.01, "x");
+        check_near(f.p[1], s.p[1], 0.01, "y");
+        check_near(angle_crop_to_range(f.angle - s.angle), 0.0, 1e-4, "angle");
+    });
+});
+
+static test_registration_t fixed_collision("fixed/fixed point collision hits the same pixels", [](std::mt19937 &rng) {
+    logic_bitmap_t map = {256, 256, std::vector<unsigned char>(256*256, 0)};
+    for (auto &pixel : map.bitmap) pixel = uniform_int(rng, 0, 1) ? 255 : 0;
+    std::vector<position_t> points;
+    for (double x = -32; x <= 32; x += 8.0)
+        for (double y = -16; y <= 16; y += 8.0)
+            points.push_back({x, y});
+    for_all(rng, 10000, [](std::mt19937 &rng) {
+        return std::make_pair(position_t{uniform(rng, 40.0, 216.0), uniform(rng, 40.0, 216.0)}, uniform(rng, -M_PI, M_PI));
+    }, [&](const auto &c) {
+        auto [p, angle] = c;
+        for (const auto &point : points) {
+            auto expected = check_collision({point}, p, angle, map);
+            auto result = check_collision_fixed({point}, p, angle, map);
+            auto hp = rotate_around(point, angle) + p;
+            // only points right on a pixel border may fall into the other pixel
+            bool on_border = (std::abs(hp[0] - std::round(hp[0])) < 1e-4) || (std::abs(hp[1] - std::round(hp[1])) < 1e-4);
+            check((expected.size() == result.size()) || on_border, "different collisions");
+            if ((expected.size() == 1) && (result.size() == 1)) check(~(expected[0] - result[0]) < 1e-4, "different collision point");
+        }
+    });
+});
+
+}
+}
@@ -0,0 +1,140 @@
+/*
+
+MIT License with AI exception
+
+Copyright (c) Tadeusz Puźniakowski 2024
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is furnished
+to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+Additional restriction:
+
+The Software may not be used, in whole or in part, to teach or train any
+artificial intelligence system, including but not limited to large language
+models (LLMs), neural networks, or any other type of AI technology. Violation of
+this restriction will be considered a breach of this License.
+
+*/
+
+
+
+#include "property.h"
+#include "../graphics.h"
+
+#include <memory>
+
+namespace mcggame {
+namespace test {
+
+static test_registration_t split_screen_tiles("graphics/split_screen tiles the screen without gaps", [](std::mt19937 &rng) {
+    for_all(rng, 1000, [](std::mt19937 &rng) {
+        return std::make_tuple(uniform_int(rng, 1, 16), uniform_int(rng, 16, 2000), uniform_int(rng, 16, 2000));
+    }, [](const auto &c) {
+        auto [n, w, h] = c;
+        auto viewports = split_screen(n, w, h);
+        check((int)viewports.size() == n, "wrong number of viewports");
+        long area = 0;
+        for (size_t i = 0; i < viewports.size(); i++) {
+            const auto &v = viewports[i];
+            check((v.x >= 0) && (v.y >= 0) && (v.x + v.w <= w) && (v.y + v.h <= h), "viewport outside the screen");
+            check((v.w > 0) && (v.h > 0), "empty viewport");
+            area += (long)v.w*v.h;
+            for (size_t j = 0; j < i; j++)
+                check(!SDL_HasIntersection(&v, &viewports[j]), "viewports overlap");
+        }
+        check(area == (long)w*h, "viewports do not cover the screen");
+    });
+});
+
+static test_registration_t view_round_trip("graphics/view_t from_screen inverts to_screen", [](std::mt19937 &rng) {
+    for_all(rng, 10000, [](std::mt19937 &rng) {
+        view_t view = {{uniform_int(rng, 0, 320), uniform_int(rng, 0, 240), uniform_int(rng, 16, 640), uniform_int(rng, 16, 480)},
+                       {uniform(rng, -1000.0, 1000.0), uniform(rng, -1000.0, 1000.0)},
+                       uniform(rng, 0.1, 4.0)};
+        return std::make_pair(view, position_t{uniform(rng, -2000.0, 2000.0), uniform(rng, -2000.0, 2000.0)});
+    }, [](const auto &c) {
+        const auto &[view, p] = c;
+        // to_screen is relative to the viewport, from_screen takes the whole screen
+        auto s = view.to_screen(p) + position_t{(double)view.viewport.x, (double)view.viewport.y};
+        auto q = view.from_screen(s);
+        check_near(q[0], p[0], 1e-9, "x");
+        check_near(q[1], p[1], 1e-9, "y");
+        if (view.contains_screen_point(s)) check(view.is_visible(p, 0.0), "a point on the screen is not visible");
+    });
+});
+
+using surface_p = std::shared_ptr<SDL_Surface>;
+
+static surface_p argb_surface(const int w, const int h) {
+    return surface_p(SDL_CreateRGBSurfaceWithFormat(0, w, h, 32, SDL_PIXELFORMAT_ARGB8888), [](auto p){SDL_FreeSurface(p);});
+}
+
+static uint32_t &pixel(const surface_p &s, const int x, const int y) {
+    return ((uint32_t *)((uint8_t *)s->pixels + y*s->pitch))[x];
+}
+
+static surface_p random_sprite(std::mt19937 &rng) {
+    int size = 2*uniform_int(rng, 2, 32);
+    auto sprite = argb_surface(size, size);
+    for (int y = 0; y < size; y++)
+        for (int x = 0; x < size; x++)
+            pixel(sprite, x, y) = (uniform_int(rng, 0, 3) == 0) ? 0 : (0xff000000u | (uint32_t)(rng() & 0x0ffffff));
+    return sprite;
+}
+
+static test_registration_t rotate_surface_quarter_turns("graphics/rotate_surface by quarter turns moves pixels exactly", [](std::mt19937 &rng) {
+    for_all(rng, 200, random_sprite, [](const surface_p &sprite) {
+        int n = sprite->w;
+        int margin = 3;
+        auto target = argb_surface(n + 2*margin, n + 2*margin);
+        SDL_Rect rect = {0, 0, target->w, target->h};
+        for (int quarter = 0; quarter < 4; quarter++) {
+            rotate_surface(sprite.get(), target.get(), rect, quarter*M_PI*0.5);
+            for (int y = 0; y < n; y++)
+                for (int x = 0; x < n; x++) {
+                    // clockwise on the screen, as SDL_RenderCopyEx
+                    int tx = x, ty = y;
+                    for (int i = 0; i < quarter; i++) {
+                        int t = tx;
+                        tx = n - 1 - ty;
+                        ty = t;
+                    }
+                    check(pixel(target, tx + margin, ty + margin) == pixel(sprite, x, y), "pixel moved to a wrong place");
+                }
+            for (int x = 0; x < target->w; x++)
+                check(pixel(target, x, 0) == 0, "the margin is not transparent");
+        }
+    });
+});
+
+static test_registration_t sprite_cache_frames("graphics/rotated_sprite_cache_c picks the nearest frame", [](std::mt19937 &rng) {
+    auto sprite = argb_surface(8, 8);
+    for_all(rng, 100, [](std::mt19937 &rng) { return uniform_int(rng, 1, 256); }, [&](const int frames) {
+        rotated_sprite_cache_c cache(nullptr, sprite.get(), frames);
+        for (int i = 0; i < 100; i++) {
+            double angle = (i - 50)*0.37;
+            int frame = cache.frame_index(angle);
+            check((frame >= 0) && (frame < frames), "frame out of range");
+            double frame_angle = frame*2.0*M_PI/frames;
+            check(std::abs(angle_crop_to_range(angle - frame_angle)) <= M_PI/frames + 1e-9, "not the nearest frame");
+        }
+    });
+});
+
+}
+}
@@ -0,0 +1,169 @@
+/*
+
+MIT License with AI exception
+
+Copyright (c) Tadeusz Puźniakowski 2024
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is furnished
+to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+Additional restriction:
+
+The Software may not be used, in whole or in part, to teach or train any
+artificial intelligence system, including but not limited to large language
+models (LLMs), neural networks, or any other type of AI technology. Violation of
+this restriction will be considered a breach of this License.
+
+*/
+
+
+
+#include "property.h"
+#include "../net.h"
+
+namespace mcggame {
+namespace test {
+
+using namespace mcggame::net;
+
+static car_state_t random_state(std::mt19937 &rng) {
+    return {{uniform(rng, -1e5, 1e5), uniform(rng, -1e5, 1e5)},
+            {uniform(rng, -1e4, 1e4), uniform(rng, -1e4, 1e4)},
+            {0.0, 0.0},
+            uniform(rng, -100.0, 100.0)};
+}
+
+static test_registration_t quantize_round_trip("net/dequantize(quantize(s)) is within half a quantum", [](std::mt19937 &rng) {
+    for_all(rng, 100000, random_state, [](const car_state_t &s) {
+        auto q = dequantize(quantize(s));
+        check_near(q.p[0], s.p[0], position_quantum*0.5, "x");
+        check_near(q.p[1], s.p[1], position_quantum*0.5, "y");
+        check_near(q.v[0], s.v[0], position_quantum*0.5, "vx");
+        check_near(q.v[1], s.v[1], position_quantum*0.5, "vy");
+        // compared as directions, -pi and pi are the same
+        check_near(angle_crop_to_range(q.angle - s.angle), 0.0, angle_quantum*0.5 + 1e-9, "angle");
+        auto qq = quantize(q);
+        auto q0 = quantize(s);
+        check((qq.x == q0.x) && (qq.y == q0.y) && (qq.vx == q0.vx) && (qq.vy == q0.vy), "quantizing twice changes the position");
+    });
+});
+
+static test_registration_t varint_round_trip("net/varint and svarint round trip", [](std::mt19937 &rng) {
+    for_all(rng, 10000, [](std::mt19937 &rng) {
+        std::vector<int64_t> values;
+        int n = uniform_int(rng, 1, 50);
+        for (int i = 0; i < n; i++) {
+            // all magnitudes, including the extremes
+            int bits = uniform_int(rng, 0, 64);
+            uint64_t v = (bits == 64) ? rng() | ((uint64_t)rng() << 32) : ((((uint64_t)rng() << 32) | rng()) & ((1ull << bits) - 1));
+            values.push_back((int64_t)v);
+        }
+        return values;
+    }, [](const std::vector<int64_t> &values) {
+        byte_writer_t w;
+        for (auto v : values) {
+            w.varint((uint64_t)v);
+            w.svarint(v);
+            w.svarint(-v);
+        }
+        byte_reader_t r(w.data);
+        for (auto v : values) {
+            check(r.varint() == (uint64_t)v, "varint");
+            check(r.svarint() == v, "svarint");
+            check(r.svarint() == (int64_t)(0 - (uint64_t)v), "negative svarint");
+        }
+        check(r.ok && r.at_end(), "bytes left");
+    });
+});
+
+static snapshot_t random_snapshot(std::mt19937 &rng, const snapshot_t *baseline) {
+    snapshot_t s;
+    s.tick = baseline ? baseline->tick + uniform_int(rng, 1, 100) : uniform_int(rng, 1, 1000000);
+    s.input_ack = uniform_int(rng, 0, 1000000);
+    int count = uniform_int(rng, 0, 20);
+    s.your_car = uniform_int(rng, 0, count);
+    for (int i = 0; i < count; i++) {
+        // cars of the baseline move a little, new cars are anywhere
+        if (baseline && (i < (int)baseline->cars.size())) {
+            auto c = baseline->cars[i];
+            c.x += uniform_int(rng, -64, 64);
+            c.y += uniform_int(rng, -64, 64);
+            c.vx += uniform_int(rng, -16, 16);
+            c.vy += uniform_int(rng, -16, 16);
+            c.angle += uniform_int(rng, -300, 300);
+            s.cars.push_back(c);
+        } else {
+            s.cars.push_back(quantize(random_state(rng)));
+        }
+    }
+    return s;
+}
+
+static bool same_snapshot(const snapshot_t &a, const snapshot_t &b) {
+    if ((a.tick != b.tick) || (a.input_ack != b.input_ack) || (a.your_car != b.your_car) || (a.cars.size() != b.cars.size())) return false;
+    for (size_t i = 0; i < a.cars.size(); i++) {
+        const auto &x = a.cars[i];
+        const auto &y = b.cars[i];
+        if ((x.x != y.x) || (x.y != y.y) || (x.vx != y.vx) || (x.vy != y.vy) || (x.angle != y.angle)) return false;
+    }
+    return true;
+}
+
+static test_registration_t snapshot_delta_round_trip("net/snapshots round trip with and without a baseline", [](std::mt19937 &rng) {
+    for_all(rng, 5000, [](std::mt19937 &rng) {
+        auto baseline = random_snapshot(rng, nullptr);
+        auto snapshot = random_snapshot(rng, &baseline);
+        return std::make_pair(baseline, snapshot);
+    }, [](const auto &c) {
+        const auto &[baseline, snapshot] = c;
+        auto find = [&](uint32_t tick) { return (tick == baseline.tick) ? &baseline : nullptr; };
+
+        byte_writer_t full;
+        write_snapshot(full, snapshot, nullptr);
+        byte_writer_t delta;
+        write_snapshot(delta, snapshot, &baseline);
+
+        for (auto *w : {&full, &delta}) {
+            byte_reader_t r(w->data);
+            snapshot_t read;
+            check(read_snapshot(r, read, find), "could not read the snapshot");
+            check(r.at_end(), "bytes left");
+            check(same_snapshot(read, snapshot), "different snapshot");
+        }
+
+        byte_reader_t r(delta.data);
+        snapshot_t read;
+        check(!read_snapshot(r, read, [](uint32_t) { return nullptr; }), "read a delta without its baseline");
+    });
+});
+
+static test_registration_t snapshot_truncated("net/truncated snapshots are rejected", [](std::mt19937 &rng) {
+    for_all(rng, 2000, [](std::mt19937 &rng) { return random_snapshot(rng, nullptr); }, [](const snapshot_t &snapshot) {
+        byte_writer_t w;
+        write_snapshot(w, snapshot, nullptr);
+        for (size_t n = 0; n < w.data.size(); n++) {
+            std::vector<uint8_t> truncated(w.data.begin(), w.data.begin() + n);
+            byte_reader_t r(truncated);
+            snapshot_t read;
+            check(!read_snapshot(r, read, [](uint32_t) { return nullptr; }), "read a truncated snapshot of " + std::to_string(n) + " bytes");
+        }
+    });
+});
+
+}
+}
@@ -0,0 +1,243 @@
+/*
+
+MIT License with AI exception
+
+Copyright (c) Tadeusz Puźniakowski 2024
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is furnished
+to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+Additional restriction:
+
+The Software may not be used, in whole or in part, to teach or train any
+artificial intelligence system, including but not limited to large language
+models (LLMs), neural networks, or any other type of AI technology. Violation of
+this restriction will be considered a breach of this License.
+
+*/
+
+
+#include "property.h"
+#include "../offscreen.h"
+#include "../game.h"
+
+#include <cstdio>
+#include <filesystem>
+#include <iostream>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace mcggame {
+namespace test {
+
+static std::shared_ptr<SDL_Surface> filled_frame(const int w, const int h, const Uint32 color) {
+    auto frame = std::shared_ptr<SDL_Surface>(SDL_CreateRGBSurfaceWithFormat(0, w, h, 32, SDL_PIXELFORMAT_ARGB8888), [](auto p){SDL_FreeSurface(p);});
+    SDL_FillRect(frame.get(), nullptr, color);
+    return frame;
+}
+
+static test_registration_t offscreen_frames_in_order("offscreen/frames are written in order and with their pixels", [](std::mt19937 &rng) {
+    auto directory = std::filesystem::temp_directory_path() / ("mcggame_frames_" + std::to_string(rng()));
+    std::filesystem::create_directories(directory);
+    const int frames = uniform_int(rng, 1, 20);
+    std::vector<Uint32> colors;
+    {
+        frame_writer_c writer((directory / "frame_%03d.bmp").string(), uniform_int(rng, 1, 4));
+        for (int i = 0; i < frames; i++) {
+            colors.push_back(0xff000000u | (rng() & 0x00ffffffu));
+            // the writer keeps a copy, the frame can change right after
+            auto frame = filled_frame(16, 8, colors.back());
+            writer.write(frame.get());
+            SDL_FillRect(frame.get(), nullptr, 0);
+        }
+        writer.flush();
+        check(writer.frames_written() == frames, "not every frame was written");
+    }
+    for (int i = 0; i < frames; i++) {
+        char fname[32];
+        std::snprintf(fname, sizeof(fname), "frame_%03d.bmp", i);
+        auto loaded = std::shared_ptr<SDL_Surface>(SDL_LoadBMP((directory / fname).string().c_str()), [](auto p){SDL_FreeSurface(p);});
+        check((bool)loaded, std::string("missing ") + fname);
+        auto pixels = std::shared_ptr<SDL_Surface>(SDL_ConvertSurfaceFormat(loaded.get(), SDL_PIXELFORMAT_ARGB8888, 0), [](auto p){SDL_FreeSurface(p);});
+        check((pixels->w == 16) && (pixels->h == 8), "different size");
+        check((((Uint32 *)pixels->pixels)[0] & 0x00ffffffu) == (colors[i] & 0x00ffffffu), std::string("different color in ") + fname);
+    }
+    std::filesystem::remove_all(directory);
+});
+
+static test_registration_t offscreen_write_errors("offscreen/a failed write is reported to the caller", [](std::mt19937 &) {
+    bool thrown = false;
+    try {
+        frame_writer_c writer("/nonexistent/mcggame/frame_%03d.bmp");
+        auto frame = filled_frame(4, 4, 0xff00ff00u);
+        writer.write(frame.get());
+        writer.flush();
+    } catch (const std::runtime_error &) {
+        thrown = true;
+    }
+    check(thrown, "writing to a missing directory did not fail");
+});
+
+static test_registration_t offscreen_frame_pattern("offscreen/the frame file pattern must have exactly one int conversion", [](std::mt19937 &) {
+    auto directory = std::filesystem::temp_directory_path().string();
+    for (const std::string pattern : {"frame.bmp", "frame_%s.bmp", "frame_%n.bmp", "frame_%d_%d.bmp", "frame_%ld.bmp",
+                                      "frame_%*d.bmp", "frame_%f.bmp", "frame_%", "frame_%%.bmp"}) {
+        bool thrown = false;
+        try {
+            frame_writer_c writer(directory + "/" + pattern);
+        } catch (const std::invalid_argument &) {
+            thrown = true;
+        }
+        check(thrown, "accepted the pattern " + pattern);
+    }
+    for (const std::string pattern : {"frame_%05d.bmp", "frame_%%_%d.bmp", "frame_%-3i.bmp", "frame_%#x.bmp", "frame_%.4u.bmp"}) {
+        try {
+            frame_writer_c writer(directory + "/" + pattern);
+        } catch (const std::invalid_argument &) {
+            check(false, "rejected the pattern " + pattern);
+        }
+    }
+});
+
+static logic_bitmap_t open_field(const int w, const int h) {
+    logic_bitmap_t map;
+    map.w = w;
+    map.h = h;
+    map.bitmap.assign(w*h, 0);
+    return map;
+}
+
+/**
+ * @brief Color of the output pixel under a point of the game view.
+ */
+static Uint32 pixel_at(const SDL_Surface *surface, const position_t &p) {
+    int x = (int)(p[0]*surface->w/game_view_width);
+    int y = (int)(p[1]*surface->h/game_view_height);
+    return ((const Uint32 *)((const char *)surface->pixels + y*surface->pitch))[x] & 0x00ffffffu;
+}
+
+static test_registration_t offscreen_draws_world("offscreen/the track and a car are drawn into the surface", [](std::mt19937 &rng) {
+    const Uint32 background = 0x00ff00u, wall = 0xff0000u, paint = 0x0000ffu;
+    offscreen_target_c target(game_view_width/4, game_view_height/4);
+
+    // road on the left half is transparent, the walls on the right half are red
+    track_asset_t asset;
+    asset.surface = filled_frame(game_view_width, game_view_height, 0);
+    SDL_Rect wall_rect = {game_view_width/2, 0, game_view_width/2, game_view_height};
+    SDL_FillRect(asset.surface.get(), &wall_rect, 0xff000000u | wall);
+    asset.collision_map = open_field(game_view_width, game_view_height);
+    for (int y = 0; y < game_view_height; y++)
+        for (int x = game_view_width/2; x < game_view_width; x++) asset.collision_map(x, y) = 255;
+    race_track_t race_track(asset, target.get_renderer());
+
+    auto car = car_t::create(nullptr, nullptr, {uniform(rng, 60.0, 250.0), uniform(rng, 60.0, 420.0)});
+    car.angle = uniform(rng, -M_PI, M_PI);
+    car.set_sprite(target.get_renderer(), sprite_asset_t{filled_frame(64, 64, 0xff000000u | paint)});
+
+    const position_t cam = {game_view_width*0.5, game_view_height*0.5};
+    SDL_SetRenderDrawColor(target.get_renderer(), 0, 255, 0, 255);
+    SDL_RenderClear(target.get_renderer());
+    race_track.draw(cam[0], cam[1]);
+    car.draw(cam);
+    target.present();
+
+    auto surface = target.surface();
+    check(pixel_at(surface, race_track_t::to_screen_coordinates(car.p, cam)) == paint, "the car is not drawn");
+    for (const position_t p : {position_t{20.0, 20.0}, position_t{20.0, 460.0}, position_t{300.0, 20.0}, position_t{300.0, 460.0}}) {
+        if (~(p - car.p) < car_t::draw_radius() + 8.0) continue;
+        check(pixel_at(surface, p) == background, "the road is not transparent");
+    }
+    for (const position_t p : {position_t{340.0, 20.0}, position_t{480.0, 240.0}, position_t{620.0, 460.0}})
+        check(pixel_at(surface, p) == wall, "the wall is not drawn");
+});
+
+static test_registration_t autopilot_turns_away("autopilot/turns away from a wall on one side and backs off when blocked", [](std::mt19937 &rng) {
+    for_all(rng, 100, [](std::mt19937 &rng) {
+        return std::make_pair(uniform(rng, 20.0, 80.0), uniform(rng, -0.2, 0.2));
+    }, [](const std::pair<double, double> &c) {
+        auto [distance, angle] = c;
+        // a wall across the road, slanted so that the right side is farther
+        auto map = open_field(600, 400);
+        for (int y = 0; y < map.h; y++)
+            for (int x = 300 + (int)(distance + y*0.5); x < map.w; x++) map(x, y) = 255;
+        car_state_t car = {};
+        car.p = {300.0 - 32.0, 100.0};
+        car.angle = angle;
+        input_autopilot_c autopilot;
+        autopilot.look(car, map);
+        auto a = autopilot.get_state().p;
+        check(a[0] > 0.0, "does not turn toward the open side");
+        check(a[1] > 0.0, "does not drive on");
+
+        car.p = {300.0 - 32.0 + distance + 50.0 - 4.0, 100.0};
+        autopilot.look(car, map);
+        check(autopilot.get_state().p[1] < 0.0, "does not back off from the wall");
+    });
+});
+
+static test_registration_t offscreen_raw_stream_clean("offscreen/the raw stream on stdout holds only the frames while cars hit walls", [](std::mt19937 &rng) {
+    track_asset_t asset;
+    asset.collision_map = open_field(400, 300);
+    for (int y = 0; y < 300; y++)
+        for (int x = 200; x < 400; x++) asset.collision_map(x, y) = 255;
+    auto race_track = std::make_shared<race_track_t>(asset, nullptr);
+    auto autopilot = std::make_shared<input_autopilot_c>();
+    auto car = car_t::create(nullptr, autopilot, {150.0, uniform(rng, 50.0, 250.0)});
+    car.v = {300.0, 0.0};
+    std::vector<car_t> cars = {car};
+
+    const int w = uniform_int(rng, 1, 32), h = uniform_int(rng, 1, 32), frames = uniform_int(rng, 10, 30);
+    auto path = std::filesystem::temp_directory_path() / ("mcggame_stdout_" + std::to_string(rng()));
+    repair_stats_t repair_stats;
+    std::cout.flush();
+    std::fflush(stdout);
+    int saved = dup(1);
+    int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    dup2(fd, 1);
+    close(fd);
+    auto restore = [&]() {
+        std::cout.flush();
+        std::fflush(stdout);
+        dup2(saved, 1);
+        close(saved);
+    };
+    try {
+        frame_writer_c writer("-");
+        std::vector<position_t> collisions;
+        for (int frame = 0; frame < frames; frame++) {
+            for (int tick = 0; tick < 3; tick++) {
+                autopilot->look(cars[0].state(), race_track->_collision_map);
+                cars = simulation_step(cars, race_track, 0.01, collisions, {}, &repair_stats);
+            }
+            writer.write(filled_frame(w, h, 0xff000000u | frame).get());
+        }
+        writer.flush();
+    } catch (...) {
+        restore();
+        throw;
+    }
+    restore();
+    auto size = std::filesystem::file_size(path);
+    std::filesystem::remove(path);
+    check(repair_stats.repairs > 0, "the car did not hit the wall");
+    check(size == (uintmax_t)frames*w*h*4, "stdout has " + std::to_string(size) + " bytes, not " + std::to_string(frames*w*h*4));
+});
+
+}
+}
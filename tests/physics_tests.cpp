@@ -0,0 +1,167 @@
+/*
+
+MIT License with AI exception
+
+Copyright (c) Tadeusz Puźniakowski 2024
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is furnished
+to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+Additional restriction:
+
+The Software may not be used, in whole or in part, to teach or train any
+artificial intelligence system, including but not limited to large language
+models (LLMs), neural networks, or any other type of AI technology. Violation of
+this restriction will be considered a breach of this License.
+
+*/
+
+
+
+#include "property.h"
+#include "../physics.h"
+
+#include <algorithm>
+#include <limits>
+
+namespace mcggame {
+namespace test {
+
+/**
+ * @brief The car update from before the physics policies, kept as the
+ * reference for the arcade model.
+ */
+static car_state_t reference_update(const car_state_t &s, const input_state_t &input_v, const double dt) {
+    car_state_t ret = s;
+    auto v = s.v;
+    auto angle = s.angle;
+    auto p = s.p;
+
+    auto friction = calculate_friction_acceleration(v, 0.5);
+
+    auto forward_vector = rotate_around({1.0,0.0}, ret.angle);
+    auto backward_vector = rotate_around({-1.0,0.0}, ret.angle);
+    auto forward_acceleration = forward_vector * input_v.p[1]*160.0;
+
+    if (~v > 0.0001) {
+        auto angle_to_correct_a = angle_between_vectors(forward_vector, v);
+        auto angle_to_correct_b = angle_between_vectors(backward_vector, v);
+        bool is_moving_forward = (std::abs(angle_to_correct_a) < std::abs(angle_to_correct_b));
+        auto angle_to_correct = is_moving_forward?angle_to_correct_a:angle_to_correct_b;
+        auto movement_correction_angle = angle_to_correct * ((~v > 1.0)?0.02:0.9);
+        if ((~v > 100.0) && (std::abs(angle_to_correct ) > 0.001)) {
+            friction = calculate_friction_acceleration(v, 0.9);
+        }
+        ret.v = rotate_around(ret.v,-movement_correction_angle);
+
+        if (is_moving_forward) ret.angle = angle_crop_to_range(angle + input_v.p[0]*0.0001*~v);
+        else ret.angle = angle_crop_to_range(angle + input_v.p[0]*(-0.0001)*~v);
+    }
+
+    std::array<position_t,3> r = update_phys_point(p, ret.v, forward_acceleration + friction, dt);
+    ret.p = r[0];
+    ret.v = r[1];
+    ret.a = r[2];
+    if (~ret.v < 0.005) {
+        ret.v = {0.0,0.0};
+    }
+    return ret;
+}
+
+/**
+ * @brief Compares two states up to rounding: every component may differ by
+ * a few units of roundoff at the magnitude of the state. Positions, velocities
+ * and the angle go through the same sums, so a small component next to a large
+ * one is only as exact as the large one.
+ */
+static bool equal_up_to_rounding(const car_state_t &a, const car_state_t &b, const double ulps) {
+    double scale = 1.0;
+    for (const car_state_t *s : {&a, &b}) {
+        for (double x : {s->p[0], s->p[1], s->v[0], s->v[1], s->a[0], s->a[1], s->angle})
+            scale = std::max(scale, std::abs(x));
+    }
+    const double tolerance = ulps * std::numeric_limits<double>::epsilon() * scale;
+    return (std::abs(a.p[0] - b.p[0]) <= tolerance) && (std::abs(a.p[1] - b.p[1]) <= tolerance) &&
+           (std::abs(a.v[0] - b.v[0]) <= tolerance) && (std::abs(a.v[1] - b.v[1]) <= tolerance) &&
+           (std::abs(a.a[0] - b.a[0]) <= tolerance) && (std::abs(a.a[1] - b.a[1]) <= tolerance) &&
+           (std::abs(a.angle - b.angle) <= tolerance);
+}
+
+static std::pair<car_state_t, input_state_t> random_car(std::mt19937 &rng) {
+    // speeds on a log scale, so the stop, slow and drifting branches are all taken
+    double speed = std::pow(10.0, uniform(rng, -4.0, 3.0));
+    double direction = uniform(rng, -M_PI, M_PI);
+    car_state_t s = {{uniform(rng, -2000.0, 2000.0), uniform(rng, -2000.0, 2000.0)},
+                     rotate_around({speed, 0.0}, direction),
+                     {0.0, 0.0},
+                     uniform(rng, -M_PI, M_PI)};
+    input_state_t input = {{(double)uniform_int(rng, -1, 1), (double)uniform_int(rng, -1, 1)}};
+    return {s, input};
+}
+
+// The arcade model is not compared bit for bit: with -march=native the compiler
+// contracts a*b+c into fused multiply-adds in one copy of the update and not in
+// the other, and -ffp-contract=off does not stop the vectorizer from doing the
+// same, so only agreement up to rounding holds for every build.
+static test_registration_t arcade_matches_reference("physics/arcade model matches the reference update up to rounding", [](std::mt19937 &rng) {
+    for_all(rng, 200000, random_car, [](const auto &c) {
+        const auto &[s, input] = c;
+        check(equal_up_to_rounding(arcade_physics::step(s, input, 0.01), reference_update(s, input, 0.01), 4), "different state");
+        check(physics_model_from_string("arcade") == &arcade_physics::step, "arcade is not the default model");
+    });
+});
+
+static test_registration_t arcade_trajectory_matches_reference("physics/arcade trajectories follow the reference update", [](std::mt19937 &rng) {
+    for_all(rng, 200, random_car, [&](const auto &c) {
+        auto [s, input] = c;
+        auto r = s;
+        for (int i = 0; i < 1000; i++) {
+            s = arcade_physics::step(s, input, 0.01);
+            r = reference_update(r, input, 0.01);
+            check(equal_up_to_rounding(s, r, 64), "different state after " + std::to_string(i + 1) + " steps");
+        }
+    });
+});
+
+static test_registration_t models_are_sane("physics/every model keeps the state finite and the angle cropped", [](std::mt19937 &rng) {
+    for (const auto &name : physics_model_names()) {
+        auto step = physics_model_from_string(name);
+        for_all(rng, 200, random_car, [&](const auto &c) {
+            auto [s, input] = c;
+            for (int i = 0; i < 500; i++) {
+                s = step(s, input, 0.01);
+                check(std::isfinite(s.p[0]) && std::isfinite(s.p[1]) && std::isfinite(s.v[0]) && std::isfinite(s.v[1]), name + ": state is not finite");
+                check((s.angle >= -M_PI) && (s.angle < M_PI), name + ": angle out of range");
+            }
+        });
+    }
+});
+
+static test_registration_t models_stop("physics/every model stops a coasting car", [](std::mt19937 &rng) {
+    for (const auto &name : physics_model_names()) {
+        auto step = physics_model_from_string(name);
+        for_all(rng, 50, random_car, [&](const auto &c) {
+            auto s = c.first;
+            for (int i = 0; i < 5000; i++) s = step(s, {{0.0, 0.0}}, 0.01);
+            check(~s.v == 0.0, name + ": the car still moves");
+        });
+    }
+});
+
+}
+}
@@ -0,0 +1,117 @@
+/*
+
+MIT License with AI exception
+
+Copyright (c) Tadeusz Puźniakowski 2024
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is furnished
+to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+Additional restriction:
+
+The Software may not be used, in whole or in part, to teach or train any
+artificial intelligence system, including but not limited to large language
+models (LLMs), neural networks, or any other type of AI technology. Violation of
+this restriction will be considered a breach of this License.
+
+*/
+
+
+
+#ifndef MCGGAME_TESTS_PROPERTY_H
+#define MCGGAME_TESTS_PROPERTY_H
+
+#include <cmath>
+#include <functional>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace mcggame {
+namespace test {
+
+/*
+ * Minimal property test harness.
+ *
+ * Every test is a function of a random generator. Tests register themselves
+ * with a static test_registration_t, and tests_main.cpp runs them all, or
+ * the ones whose name contains the filter given on the command line. The
+ * generator is seeded from --seed=N, so a failing run can be repeated.
+ */
+
+struct test_case_t {
+    std::string name;
+    std::function<void(std::mt19937 &rng)> run;
+};
+
+std::vector<test_case_t> &registered_tests();
+
+struct test_registration_t {
+    test_registration_t(const std::string &name, const std::function<void(std::mt19937 &rng)> &run) {
+        registered_tests().push_back({name, run});
+    }
+};
+
+class check_failed : public std::runtime_error {
+public:
+    check_failed(const std::string &what) : std::runtime_error(what) {}
+};
+
+inline void check(const bool condition, const std::string &what) {
+    if (!condition) throw check_failed(what);
+}
+
+inline void check_near(const double actual, const double expected, const double tolerance, const std::string &what) {
+    if (!(std::abs(actual - expected) <= tolerance)) {
+        std::stringstream ss;
+        ss.precision(17);
+        ss << what << ": " << actual << " differs from " << expected << " by more than " << tolerance;
+        throw check_failed(ss.str());
+    }
+}
+
+/**
+ * @brief Checks property on count values made by generate. The failure
+ * message tells which of the cases failed.
+ */
+template <class Generate, class Property>
+void for_all(std::mt19937 &rng, const int count, const Generate &generate, const Property &property) {
+    for (int i = 0; i < count; i++) {
+        auto value = generate(rng);
+        try {
+            property(value);
+        } catch (const check_failed &e) {
+            throw check_failed("case " + std::to_string(i) + ": " + e.what());
+        }
+    }
+}
+
+inline double uniform(std::mt19937 &rng, const double a, const double b) {
+    return std::uniform_real_distribution<double>(a, b)(rng);
+}
+
+inline int uniform_int(std::mt19937 &rng, const int a, const int b) {
+    return std::uniform_int_distribution<int>(a, b)(rng);
+}
+
+}
+}
+
+#endif
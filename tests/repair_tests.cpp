@@ -0,0 +1,165 @@
+/*
+
+MIT License with AI exception
+
+Copyright (c) Tadeusz Puźniakowski 2024
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is furnished
+to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+Additional restriction:
+
+The Software may not be used, in whole or in part, to teach or train any
+artificial intelligence system, including but not limited to large language
+models (LLMs), neural networks, or any other type of AI technology. Violation of
+this restriction will be considered a breach of this License.
+
+*/
+
+
+#include "property.h"
+#include "../game.h"
+
+#include <tuple>
+
+namespace mcggame {
+namespace test {
+
+struct input_constant_c : public input_i {
+    input_state_t state = {{0.0, 0.0}};
+    input_state_t get_state() const { return state; }
+};
+
+/**
+ * @brief Open field with a wall from wall_x to the right edge.
+ */
+static std::shared_ptr<race_track_t> wall_track(const int wall_x) {
+    track_asset_t asset;
+    asset.collision_map.w = 400;
+    asset.collision_map.h = 300;
+    asset.collision_map.bitmap.assign(400*300, 0);
+    for (int y = 0; y < 300; y++)
+        for (int x = wall_x; x < 400; x++) asset.collision_map(x, y) = 255;
+    return std::make_shared<race_track_t>(asset, nullptr);
+}
+
+/**
+ * @brief A car just in front of the wall at x = 200, going into it fast
+ * enough to hit it in the next tick.
+ */
+static car_t car_heading_into_wall(std::mt19937 &rng) {
+    double angle = uniform(rng, -0.3, 0.3);
+    double speed = uniform(rng, 300.0, 500.0);
+    auto car = car_t::create(nullptr, std::make_shared<input_constant_c>(), {200.0 - 33.0 - 16.0*std::abs(std::sin(angle)), uniform(rng, 100.0, 200.0)});
+    car.angle = angle;
+    car.v = rotate_around({speed, 0.0}, uniform(rng, -0.2, 0.2));
+    return car;
+}
+
+static test_registration_t repair_within_budget("repair/the search stays within the work budget", [](std::mt19937 &rng) {
+    auto track = wall_track(200);
+    for_all(rng, 50, [](std::mt19937 &rng) {
+        return std::make_pair(car_heading_into_wall(rng), uniform_int(rng, 1, 60));
+    }, [&](const std::pair<car_t, int> &c) {
+        auto [car, budget] = c;
+        simulation_params_t params;
+        params.repair_budget = budget;
+        repair_stats_t stats;
+        std::vector<position_t> collisions;
+        auto next = simulation_step({car, car}, track, 0.01, collisions, params, &stats)[0];
+        check(stats.repairs == 2, "the cars did not hit the wall");
+        check(stats.evaluations <= 2*(uint64_t)budget, "spent more than the budget of the two cars");
+        check(stats.fixed + stats.not_fixed + stats.overruns == stats.repairs, "repairs not accounted for");
+        check(check_collision(next, *track).empty(), "the car is left in the wall");
+    });
+});
+
+static test_registration_t repair_budget_per_car("repair/a car is repaired the same with or without other cars in the tick", [](std::mt19937 &rng) {
+    auto track = wall_track(200);
+    for_all(rng, 50, [](std::mt19937 &rng) {
+        return std::make_tuple(car_heading_into_wall(rng), car_heading_into_wall(rng), uniform_int(rng, 1, 60));
+    }, [&](const std::tuple<car_t, car_t, int> &c) {
+        auto [other, car, budget] = c;
+        simulation_params_t params;
+        params.repair_budget = budget;
+        std::vector<position_t> collisions;
+        auto alone = simulation_step({car}, track, 0.01, collisions, params)[0];
+        auto next = simulation_step({other, other, car}, track, 0.01, collisions, params)[2];
+        check((next.p == alone.p) && (next.v == alone.v) && (next.angle == alone.angle), "the cars before it changed the repair");
+    });
+});
+
+static test_registration_t repair_overrun_reverts("repair/after an overrun the car is back on its last pose and does not go into the wall", [](std::mt19937 &rng) {
+    auto track = wall_track(200);
+    for_all(rng, 50, car_heading_into_wall, [&](const car_t &car) {
+        simulation_params_t params;
+        params.repair_budget = 1;
+        repair_stats_t stats;
+        std::vector<position_t> collisions;
+        auto next = simulation_step({car}, track, 0.01, collisions, params, &stats)[0];
+        check(stats.overruns == 1, "no overrun with the budget of one evaluation");
+        check((next.p == car.p) && (next.angle == car.angle), "not on the last pose");
+        check(next.v[0] <= 1e-6, "still moving into the wall");
+        check_near(next.v[1], car.update(0.01).v[1], 1.0, "the velocity along the wall is lost");
+    });
+});
+
+static test_registration_t repair_unlimited_budget("repair/the default budget repairs like an unlimited one", [](std::mt19937 &rng) {
+    auto track = wall_track(200);
+    for_all(rng, 50, car_heading_into_wall, [&](const car_t &car) {
+        simulation_params_t unlimited;
+        unlimited.repair_budget = 0;
+        repair_stats_t stats;
+        std::vector<position_t> collisions;
+        auto expected = simulation_step({car}, track, 0.01, collisions, unlimited)[0];
+        auto next = simulation_step({car}, track, 0.01, collisions, simulation_params_t(), &stats)[0];
+        check(stats.overruns == 0, "the default budget ran out");
+        check((next.p == expected.p) && (next.v == expected.v) && (next.angle == expected.angle), "different repair");
+    });
+});
+
+static test_registration_t repair_cache_same_result("repair/the collision cache does not change the repair", [](std::mt19937 &rng) {
+    auto track = wall_track(200);
+    uint64_t memo_hits = 0;
+    for_all(rng, 50, car_heading_into_wall, [&](const car_t &car) {
+        auto uncached = car;
+        uncached.collision_cache = nullptr;
+        std::vector<position_t> collisions;
+        auto expected = simulation_step({uncached}, track, 0.01, collisions)[0];
+        auto next = simulation_step({car}, track, 0.01, collisions)[0];
+        check((next.p == expected.p) && (next.v == expected.v) && (next.angle == expected.angle), "different repair");
+        memo_hits += car.collision_cache->stats().memo_hits;
+    });
+    check(memo_hits > 0, "no candidate pose was found in the cache");
+});
+
+
+static test_registration_t repair_sat_mode("repair/the search gets the car out of the wall in the SAT mode", [](std::mt19937 &rng) {
+    auto track = wall_track(200);
+    track->set_collision_mode(collision_mode_e::SAT);
+    repair_stats_t stats;
+    for_all(rng, 50, car_heading_into_wall, [&](const car_t &car) {
+        std::vector<position_t> collisions;
+        auto next = simulation_step({car}, track, 0.01, collisions, simulation_params_t(), &stats)[0];
+        check(check_collision(next, *track).empty(), "the car is left in the wall");
+    });
+    check(stats.repairs > 0, "the cars did not hit the wall");
+    check(stats.fixed*10 >= stats.repairs*9, "the search did not find a pose out of the wall");
+});
+}
+}
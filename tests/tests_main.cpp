@@ -0,0 +1,79 @@
+/*
+
+MIT License with AI exception
+
+Copyright (c) Tadeusz Puźniakowski 2024
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is furnished
+to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+Additional restriction:
+
+The Software may not be used, in whole or in part, to teach or train any
+artificial intelligence system, including but not limited to large language
+models (LLMs), neural networks, or any other type of AI technology. Violation of
+this restriction will be considered a breach of this License.
+
+*/
+
+
+
+#include "property.h"
+
+#include <chrono>
+#include <iostream>
+
+namespace mcggame {
+namespace test {
+
+std::vector<test_case_t> &registered_tests() {
+    static std::vector<test_case_t> tests;
+    return tests;
+}
+
+}
+}
+
+int main(int argc, char *argv[])
+{
+    using namespace mcggame::test;
+    std::string filter;
+    unsigned seed = std::chrono::steady_clock::now().time_since_epoch().count();
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg.rfind("--seed=", 0) == 0) seed = std::stoul(arg.substr(7));
+        else filter = arg;
+    }
+
+    int failed = 0;
+    int ran = 0;
+    for (const auto &test : registered_tests()) {
+        if (test.name.find(filter) == std::string::npos) continue;
+        std::mt19937 rng(seed);
+        ran++;
+        try {
+            test.run(rng);
+            std::cout << "ok     " << test.name << std::endl;
+        } catch (const std::exception &e) {
+            failed++;
+            std::cout << "FAILED " << test.name << ": " << e.what() << std::endl;
+        }
+    }
+    std::cout << (ran - failed) << "/" << ran << " passed, seed " << seed << std::endl;
+    return (failed > 0) ? 1 : 0;
+}
@@ -0,0 +1,91 @@
+/*
+
+MIT License with AI exception
+
+Copyright (c) Tadeusz Puźniakowski 2024
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is furnished
+to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+Additional restriction:
+
+The Software may not be used, in whole or in part, to teach or train any
+artificial intelligence system, including but not limited to large language
+models (LLMs), neural networks, or any other type of AI technology. Violation of
+this restriction will be considered a breach of this License.
+
+*/
+
+
+
+#include "property.h"
+#include "../world_state.h"
+
+#include <atomic>
+#include <thread>
+
+namespace mcggame {
+namespace test {
+
+struct checked_value_t {
+    uint64_t sequence = 0;
+    std::array<uint64_t, 31> copies = {}; ///< all equal to sequence, unless the value was torn
+};
+
+static test_registration_t triple_buffer_single_thread("world_state/triple_buffer_t returns the latest published value", [](std::mt19937 &rng) {
+    triple_buffer_t<int> buffer(-1);
+    check(buffer.read() == -1, "initial value");
+    int latest = -1;
+    for_all(rng, 100000, [](std::mt19937 &rng) { return uniform_int(rng, 0, 3); }, [&](const int writes) {
+        for (int i = 0; i < writes; i++) buffer.write(++latest);
+        check(buffer.update() == (writes > 0), "update() does not tell if there is a new value");
+        check(buffer.front() == latest, "not the latest value");
+        check(!buffer.update(), "the same value is new twice");
+    });
+});
+
+static test_registration_t triple_buffer_threads("world_state/triple_buffer_t readers see whole values in order", [](std::mt19937 &) {
+    const uint64_t count = 1000000;
+    triple_buffer_t<checked_value_t> buffer;
+    std::atomic<bool> done = false;
+    std::thread writer([&]() {
+        for (uint64_t i = 1; i <= count; i++) {
+            auto &v = buffer.back();
+            v.sequence = i;
+            v.copies.fill(i);
+            buffer.publish();
+        }
+        done = true;
+    });
+    uint64_t last = 0;
+    bool torn = false;
+    bool backwards = false;
+    while (!done || (last < count)) {
+        const auto &v = buffer.read();
+        for (auto c : v.copies) torn = torn || (c != v.sequence);
+        backwards = backwards || (v.sequence < last);
+        last = v.sequence;
+    }
+    writer.join();
+    check(!torn, "torn value");
+    check(!backwards, "values out of order");
+    check(last == count, "the last value is missing");
+});
+
+}
+}
@@ -0,0 +1,134 @@
+/*
+
+MIT License with AI exception
+
+Copyright (c) Tadeusz Puźniakowski 2024
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is furnished
+to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+Additional restriction:
+
+The Software may not be used, in whole or in part, to teach or train any
+artificial intelligence system, including but not limited to large language
+models (LLMs), neural networks, or any other type of AI technology. Violation of
+this restriction will be considered a breach of this License.
+
+*/
+
+
+
+#ifndef MCGGAME_WORLD_STATE_H
+#define MCGGAME_WORLD_STATE_H
+
+#include "game.h"
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+namespace mcggame {
+
+/**
+ * @brief Lock-free single producer, single consumer triple buffer.
+ *
+ * The writer fills back() and calls publish(). The reader calls update() and
+ * then reads front(). Neither side ever waits for the other: the writer
+ * always has a free buffer, and the reader always sees the latest complete
+ * value.
+ */
+template <class T>
+class triple_buffer_t {
+    static constexpr unsigned index_mask = 0x3;
+    static constexpr unsigned fresh_bit = 0x4;
+
+    std::array<T, 3> _buffers;
+    alignas(64) std::atomic<unsigned> _middle; ///< index of the shared buffer, with fresh_bit when it was not read yet
+    alignas(64) unsigned _back;                ///< owned by the writer
+    alignas(64) unsigned _front;               ///< owned by the reader
+
+public:
+    triple_buffer_t(const T &initial = T()) : _buffers{initial, initial, initial}, _middle(1), _back(0), _front(2) {
+    }
+
+    T &back() { return _buffers[_back]; }
+
+    void publish() {
+        _back = _middle.exchange(_back | fresh_bit, std::memory_order_acq_rel) & index_mask;
+    }
+
+    void write(const T &value) {
+        back() = value;
+        publish();
+    }
+
+    /**
+     * @brief Takes the most recently published value, if there is a new one.
+     *
+     * @return true if front() changed
+     */
+    bool update() {
+        if (!(_middle.load(std::memory_order_relaxed) & fresh_bit)) return false;
+        _front = _middle.exchange(_front, std::memory_order_acq_rel) & index_mask;
+        return true;
+    }
+
+    const T &front() const { return _buffers[_front]; }
+
+    const T &read() {
+        update();
+        return front();
+    }
+};
+
+/**
+ * @brief Immutable picture of the world after one simulation tick.
+ */
+struct world_snapshot_t {
+    uint64_t tick = 0;
+    std::vector<car_state_t> cars;
+    std::vector<position_t> collisions; ///< last repaired collision points, for debugging
+};
+
+/**
+ * @brief Input that is sampled on the SDL main thread and read by the
+ * simulation thread.
+ *
+ * SDL expects the keyboard state to be used on the thread that pumps events,
+ * so sample() must be called there after SDL_PollEvent.
+ */
+class input_buffered_c : public input_i {
+    std::shared_ptr<input_i> _source;
+    mutable triple_buffer_t<input_state_t> _state;
+public:
+    input_buffered_c(std::shared_ptr<input_i> source) : _source(source), _state(input_state_t{{0.0, 0.0}}) {
+    }
+
+    void sample() {
+        _state.write(_source->get_state());
+    }
+
+    input_state_t get_state() const {
+        return _state.read();
+    }
+};
+
+}
+
+#endif